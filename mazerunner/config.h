@@ -69,8 +69,8 @@ const float ROTATION_BIAS = 0.0025; // Negative makes robot curve to left
 //***************************************************************************//
 
 // This is the size fo each cell in the maze. Normally 180mm for a classic maze
-const float FULL_CELL = 180.0f;
-const float HALF_CELL = FULL_CELL / 2.0;
+constexpr float FULL_CELL = 180.0f;
+constexpr float HALF_CELL = FULL_CELL / 2.0;
 
 //***************************************************************************//
 // Battery resistor bridge //Derek Hall//
@@ -197,6 +197,21 @@ const int BACK_WALL_TO_CENTER = 48;
 const float LOOP_FREQUENCY = 500.0;
 const float LOOP_INTERVAL = (1.0 / LOOP_FREQUENCY);
 
+// Jerk limit for forward moves in mm/s/s/s. Zero keeps the plain trapezoid
+// profile. Something like 20000 takes the edge off the acceleration steps.
+const float FORWARD_JERK = 0;
+
+// Set this to 1 to run the systick control chain - profiles, encoders,
+// motor controllers and motor drive - in fixed point arithmetic rather
+// than float. The foreground code still sees floats. See fixed.h
+#define FIXED_POINT_CONTROL 0
+
+// Set this to 1 to play the rotation of smooth turns back from the ramp
+// table in ramp_table.cpp rather than run the trapezoid. The turn shapes
+// in turns.cpp are worked out for whichever is in use.
+// Remake the table with tools/ramp_table.py
+#define TURN_PLAYBACK 0
+
 //***************************************************************************//
 // change the revision if the settings structure changes to force rewrte of EEPROM
 const int SETTINGS_REVISION = 107;
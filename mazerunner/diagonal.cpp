@@ -0,0 +1,210 @@
+/*
+ * File: diagonal.cpp
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+
+#include "diagonal.h"
+#include <Arduino.h>
+
+/***
+ * For every move type, the name, the change of heading in steps of 45
+ * degrees, positive to the right, and the number of cells the turn passes
+ * through on its way round. The cells are counted like the steps of a
+ * diagonal straight, one for each cell crossed corner to corner, so a
+ * path keeps the same number of turning cells when it is compiled.
+ */
+struct TurnType {
+  char name[7];
+  int8_t angle;
+  uint8_t cells;
+};
+
+static const TurnType turn_types[MOVE_TYPES] PROGMEM = {
+    {"STOP", 0, 0},
+    {"SS90R", 2, 1},
+    {"SS90L", -2, 1},
+    {"SS180R", 4, 2},
+    {"SS180L", -4, 2},
+    {"SD45R", 1, 0},
+    {"SD45L", -1, 0},
+    {"SD135R", 3, 1},
+    {"SD135L", -3, 1},
+    {"DS45R", 1, 0},
+    {"DS45L", -1, 0},
+    {"DS135R", 3, 1},
+    {"DS135L", -3, 1},
+    {"DD90R", 2, 0},
+    {"DD90L", -2, 0},
+};
+
+int8_t turn_angle(move_t turn) {
+  if (turn >= MOVE_TYPES) {
+    return 0;
+  }
+  return (int8_t)pgm_read_byte(&turn_types[turn].angle);
+}
+
+uint8_t turn_cells(move_t turn) {
+  if (turn >= MOVE_TYPES) {
+    return 0;
+  }
+  return pgm_read_byte(&turn_types[turn].cells);
+}
+
+static move_t *s_path;
+static int s_count;
+
+static bool add_move(move_t move) {
+  if (s_count >= MOVE_LIST_LENGTH - 1) {
+    return false;
+  }
+  s_path[s_count++] = move;
+  return true;
+}
+
+/***
+ * Diagonal straights longer than a single move are split.
+ */
+static bool add_diagonal(uint8_t steps) {
+  while (steps > MAX_DIAGONAL) {
+    if (!add_move(MOVE_DIAGONAL | MAX_DIAGONAL)) {
+      return false;
+    }
+    steps -= MAX_DIAGONAL;
+  }
+  return add_move(MOVE_DIAGONAL | steps);
+}
+
+// the left version of each turn follows the right one
+static move_t turn_to(move_t right_turn, move_t side) {
+  return (side == MOVE_LEFT) ? right_turn + 1 : right_turn;
+}
+
+/***
+ * Compile the move list from make_path() into path[], which must have
+ * room for MOVE_LIST_LENGTH moves.
+ *
+ * Only the caller needs the diagonal path so it gives the space, usually
+ * on the stack. The RAM is not taken for the whole time the mouse runs.
+ * The path cannot be compiled in place over moves[] because some runs of
+ * turns get longer. RLLR becomes SD45R DIA DD90L DIA DS45R.
+ *
+ * The straights are copied. Everything happens in the runs of turns with
+ * no straight between them. Those are turns in neighbouring cells so the
+ * mouse can cut across each cell corner to corner, through the middle of
+ * the cell edges:
+ *
+ *   - a single turn is an SS90 and a pair the same way is an SS180.
+ *   - otherwise the run starts with an SD45 onto the diagonal, or an
+ *     SD135 when the second turn is the same way as the first.
+ *   - turns that alternate, like RLRL, keep the same diagonal heading
+ *     and each cell is a step of the diagonal straight.
+ *   - two turns the same way in the middle of a run are a DD90.
+ *   - the run ends with a DS45 back to orthogonal, or a DS135 when the
+ *     last two turns are the same way.
+ *
+ * Every move has the same place in the maze as the moves it replaces so
+ * the end of the path is unchanged. If the result does not fit, the
+ * diagonal path is left empty and the function returns false. The speed
+ * run can then use the orthogonal path.
+ */
+bool compile_diagonal_path(move_t *path) {
+  s_path = path;
+  s_count = 0;
+  bool ok = true;
+  int i = 0;
+  while (ok && moves[i] != MOVE_STOP) {
+    if (moves[i] & MOVE_FORWARD) {
+      ok = add_move(moves[i]);
+      i++;
+      continue;
+    }
+    int first = i;
+    int last = i;
+    while (moves[last + 1] != MOVE_STOP && !(moves[last + 1] & MOVE_FORWARD)) {
+      last++;
+    }
+    i = last + 1;
+    if (last == first) {
+      ok = add_move(moves[first]);
+      continue;
+    }
+    if (last == first + 1 && moves[last] == moves[first]) {
+      ok = add_move(turn_to(MOVE_SS180R, moves[first]));
+      continue;
+    }
+    uint8_t steps = 1; // crossing the cell of the first turn
+    int j = first + 1;
+    if (moves[first + 1] == moves[first]) {
+      ok = add_move(turn_to(MOVE_SD135R, moves[first]));
+      j++; // crossing the second cell
+    } else {
+      ok = add_move(turn_to(MOVE_SD45R, moves[first]));
+    }
+    bool ended = false;
+    for (; ok && j <= last; j++) {
+      // moving from the cell of turn j - 1 into the cell of turn j
+      if (moves[j] == moves[j - 1]) {
+        ok = add_diagonal(steps);
+        if (j == last) {
+          ok = ok && add_move(turn_to(MOVE_DS135R, moves[j]));
+          ended = true;
+          break;
+        }
+        ok = ok && add_move(turn_to(MOVE_DD90R, moves[j]));
+        steps = 0;
+      }
+      steps++;
+    }
+    if (ok && !ended) {
+      ok = add_diagonal(steps) && add_move(turn_to(MOVE_DS45R, moves[last]));
+    }
+  }
+  if (!ok) {
+    s_count = 0;
+  }
+  path[s_count] = MOVE_STOP;
+  return ok;
+}
+
+void print_diagonal_path(const move_t *path) {
+  for (int i = 0; path[i] != MOVE_STOP; i++) {
+    move_t move = path[i];
+    if (move & MOVE_FORWARD) {
+      Serial.print(F("FWD"));
+      Serial.print(move & MAX_STRAIGHT);
+    } else if (move & MOVE_DIAGONAL) {
+      Serial.print(F("DIA"));
+      Serial.print(move & MAX_DIAGONAL);
+    } else if (move < MOVE_TYPES) {
+      Serial.print((const __FlashStringHelper *)turn_types[move].name);
+    } else {
+      Serial.print('?');
+    }
+    Serial.print(' ');
+  }
+  Serial.println(F("STOP"));
+}
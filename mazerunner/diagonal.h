@@ -0,0 +1,72 @@
+/*
+ * File: diagonal.h
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+
+#ifndef DIAGONAL_H
+#define DIAGONAL_H
+
+#include "mouse.h"
+#include <stdint.h>
+
+/***
+ * The diagonal path uses the same one byte moves as the move list made by
+ * make_path(). Orthogonal straights are MOVE_FORWARD with a count of half
+ * cells. Diagonal straights are MOVE_DIAGONAL with a count of half
+ * diagonals. That is the distance from the middle of one cell edge to the
+ * middle of the next along a diagonal, or 127mm in a classic maze.
+ *
+ * Each turn has a right and a left version. The first two letters give
+ * the kind of straight before and after the turn, so SD45R goes from an
+ * orthogonal (S) straight into a diagonal (D) one with a 45 degree right
+ * turn. DD90 is the V90 turn from one diagonal to another. MOVE_RIGHT and
+ * MOVE_LEFT are the SS90 turns.
+ */
+#define MOVE_DIAGONAL 0x40
+#define MAX_DIAGONAL 0x3F
+
+enum {
+  MOVE_SS180R = 3,
+  MOVE_SS180L,
+  MOVE_SD45R,
+  MOVE_SD45L,
+  MOVE_SD135R,
+  MOVE_SD135L,
+  MOVE_DS45R,
+  MOVE_DS45L,
+  MOVE_DS135R,
+  MOVE_DS135L,
+  MOVE_DD90R,
+  MOVE_DD90L,
+  MOVE_TYPES,
+};
+
+bool compile_diagonal_path(move_t *path);
+void print_diagonal_path(const move_t *path);
+int8_t turn_angle(move_t turn);
+uint8_t turn_cells(move_t turn);
+
+#endif // DIAGONAL_H
@@ -0,0 +1,269 @@
+/*
+ * File: dstar.cpp
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "dstar.h"
+#include "maze.h"
+#include <Arduino.h>
+
+#if DSTAR_PLANNER
+/***
+ * The g value of each cell lives in the cost array. rhs is the cost that
+ * the cell should have, one more than its cheapest neighbour. A cell is
+ * consistent when the two are the same and only inconsistent cells are
+ * in the priority queue.
+ *
+ * The queue is a binary heap of cells. The position of every cell in the
+ * heap is kept so that a cell can be removed when its rhs changes. The
+ * priority of a cell is worked out from its costs when it is needed
+ * rather than stored. When the mouse moves, all the priorities change
+ * together and the heap is simply rebuilt. That is cheaper than it
+ * sounds because only the cells on the edge of the repaired region are
+ * in the queue.
+ */
+const uint16_t NOT_QUEUED = 0xFFFF;
+
+static uint16_t s_rhs[MAZE_CELLS];
+static cell_t s_heap[MAZE_CELLS];
+static uint16_t s_heap_index[MAZE_CELLS];
+static uint16_t s_heap_size;
+static cell_t s_target;
+static cell_t s_start;
+static bool s_active = false;
+static uint32_t s_expansions = 0;
+
+static uint16_t heuristic(cell_t cell) {
+  int dx = cell / MAZE_WIDTH - s_start / MAZE_WIDTH;
+  int dy = cell % MAZE_WIDTH - s_start % MAZE_WIDTH;
+  return abs(dx) + abs(dy);
+}
+
+/***
+ * Cells are taken from the queue in order of the estimated length of a
+ * route from the mouse through the cell to the target. Ties go to the
+ * cell closest to the target.
+ */
+static uint32_t priority(cell_t cell) {
+  uint16_t g = min(cost[cell], s_rhs[cell]);
+  if (g == MAX_COST) {
+    return 0xFFFFFFFF;
+  }
+  return ((uint32_t)(g + heuristic(cell)) << 16) | g;
+}
+
+static void heap_swap(uint16_t a, uint16_t b) {
+  cell_t cell = s_heap[a];
+  s_heap[a] = s_heap[b];
+  s_heap[b] = cell;
+  s_heap_index[s_heap[a]] = a;
+  s_heap_index[s_heap[b]] = b;
+}
+
+static void sift_up(uint16_t i) {
+  while (i > 0) {
+    uint16_t parent = (i - 1) / 2;
+    if (priority(s_heap[parent]) <= priority(s_heap[i])) {
+      break;
+    }
+    heap_swap(i, parent);
+    i = parent;
+  }
+}
+
+static void sift_down(uint16_t i) {
+  while (true) {
+    uint16_t smallest = i;
+    uint16_t child = 2 * i + 1;
+    if (child < s_heap_size && priority(s_heap[child]) < priority(s_heap[smallest])) {
+      smallest = child;
+    }
+    child++;
+    if (child < s_heap_size && priority(s_heap[child]) < priority(s_heap[smallest])) {
+      smallest = child;
+    }
+    if (smallest == i) {
+      break;
+    }
+    heap_swap(i, smallest);
+    i = smallest;
+  }
+}
+
+static void heap_insert(cell_t cell) {
+  s_heap[s_heap_size] = cell;
+  s_heap_index[cell] = s_heap_size;
+  s_heap_size++;
+  sift_up(s_heap_size - 1);
+}
+
+static void heap_remove(cell_t cell) {
+  uint16_t i = s_heap_index[cell];
+  s_heap_index[cell] = NOT_QUEUED;
+  s_heap_size--;
+  if (i == s_heap_size) {
+    return;
+  }
+  cell_t moved = s_heap[s_heap_size];
+  s_heap[i] = moved;
+  s_heap_index[moved] = i;
+  sift_up(i);
+  sift_down(s_heap_index[moved]);
+}
+
+static void update_cell(cell_t cell) {
+  if (!is_target(cell, s_target)) {
+    uint16_t smallest = MAX_COST;
+    for (uint8_t direction = 0; direction < 4; direction++) {
+      if (is_exit(cell, direction)) {
+        uint16_t next = cost[neighbour(cell, direction)];
+        if (next < smallest) {
+          smallest = next;
+        }
+      }
+    }
+    s_rhs[cell] = smallest == MAX_COST ? MAX_COST : smallest + 1;
+  }
+  if (s_heap_index[cell] != NOT_QUEUED) {
+    heap_remove(cell);
+  }
+  if (cost[cell] != s_rhs[cell]) {
+    heap_insert(cell);
+  }
+}
+
+static void update_neighbours(cell_t cell) {
+  for (uint8_t direction = 0; direction < 4; direction++) {
+    if (is_exit(cell, direction)) {
+      update_cell(neighbour(cell, direction));
+    }
+  }
+}
+
+/***
+ * Take cells from the queue until the mouse's cell is consistent and no
+ * cell left in the queue could give it a lower cost.
+ */
+static void compute_shortest_path() {
+  while (s_heap_size > 0) {
+    cell_t cell = s_heap[0];
+    if (priority(cell) >= priority(s_start) && cost[s_start] == s_rhs[s_start]) {
+      break;
+    }
+    heap_remove(cell);
+    s_expansions++;
+    if (cost[cell] > s_rhs[cell]) {
+      cost[cell] = s_rhs[cell];
+      update_neighbours(cell);
+    } else {
+      cost[cell] = MAX_COST;
+      update_cell(cell);
+      update_neighbours(cell);
+    }
+  }
+}
+
+/***
+ * Start planning a route from the given cell to the target. Unseen walls
+ * are treated as absent, just as in the flood.
+ */
+void dstar_begin(cell_t target, cell_t start) {
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    cost[i] = MAX_COST;
+    s_rhs[i] = MAX_COST;
+    s_heap_index[i] = NOT_QUEUED;
+  }
+  invalidate_flood();
+  s_heap_size = 0;
+  s_target = target;
+  s_start = start;
+  s_active = true;
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    if (is_target(i, target)) {
+      s_rhs[i] = 0;
+      heap_insert(i);
+    }
+  }
+  compute_shortest_path();
+}
+
+/***
+ * Stop listening for wall changes. The costs are left as they are.
+ */
+void dstar_end() {
+  s_active = false;
+}
+
+/***
+ * The mouse has moved. Every priority depends on where the mouse is so
+ * the heap is rebuilt from the bottom up.
+ */
+void dstar_move_to(cell_t start) {
+  if (start == s_start) {
+    return;
+  }
+  s_start = start;
+  for (int i = s_heap_size / 2 - 1; i >= 0; i--) {
+    sift_down(i);
+  }
+}
+
+/***
+ * Called by set_wall_present() and set_wall_absent() whenever a wall
+ * actually changes. Only the cells on either side of the wall need to be
+ * looked at straight away.
+ */
+void dstar_wall_changed(cell_t cell, cell_t next_cell) {
+  if (!s_active) {
+    return;
+  }
+  update_cell(cell);
+  update_cell(next_cell);
+}
+
+/***
+ * Bring the costs up to date and choose the direction to leave the cell
+ * the mouse is in, with the same preference for going ahead, right, left
+ * and then behind as the flood.
+ *
+ * Returns NO_ROUTE if the target cannot be reached.
+ */
+uint8_t dstar_direction(uint8_t heading) {
+  compute_shortest_path();
+  if (cost[s_start] == MAX_COST) {
+    return NO_ROUTE;
+  }
+  return direction_to_smallest(s_start, heading);
+}
+
+/***
+ * The total number of cells taken from the queue. Used to compare the
+ * work done with the flood.
+ */
+uint32_t dstar_expansions() {
+  return s_expansions;
+}
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * File: dstar.h
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#ifndef DSTAR_H
+#define DSTAR_H
+
+#include "maze.h"
+#include <stdint.h>
+
+/***
+ * An alternative planner for the search, based on D* Lite by Koenig and
+ * Likhachev. Instead of flooding the whole maze again when a wall is
+ * found, it repairs only the costs that the wall changes and stops as
+ * soon as the cell the mouse is in has the right cost. Select it with
+ * DSTAR_PLANNER in maze.h.
+ *
+ * The costs are kept in the cost array so that direction_to_smallest()
+ * and the reports work just as they do after a flood. Cells far from the
+ * mouse may be left with MAX_COST or an out of date cost.
+ *
+ * It needs about 1k more RAM than the flood so it will not fit on an
+ * ATmega328.
+ */
+#if DSTAR_PLANNER && defined(__AVR_ATmega328P__)
+#error "The D* Lite planner will not fit in the RAM of an ATmega328"
+#endif
+
+void dstar_begin(cell_t target, cell_t start);
+void dstar_end();
+void dstar_move_to(cell_t start);
+void dstar_wall_changed(cell_t cell, cell_t next_cell);
+uint8_t dstar_direction(uint8_t heading);
+uint32_t dstar_expansions();
+
+#endif // DSTAR_H
@@ -82,11 +82,25 @@ const float MM_PER_COUNT_LEFT = (1 - ROTATION_BIAS) * PI * WHEEL_DIAMETER / (ENC
 const float MM_PER_COUNT_RIGHT = (1 + ROTATION_BIAS) * PI * WHEEL_DIAMETER / (ENCODER_PULSES * GEAR_RATIO);
 const float DEG_PER_MM_DIFFERENCE = (180.0 / (2 * MOUSE_RADIUS * PI));
 
+#if FIXED_POINT_CONTROL
+// each count moves the robot half a wheel's travel and turns it a little
+const fixed_t FWD_PER_COUNT_LEFT = (fixed_t)(0.5 * MM_PER_COUNT_LEFT * FIXED_ONE + 0.5);
+const fixed_t FWD_PER_COUNT_RIGHT = (fixed_t)(0.5 * MM_PER_COUNT_RIGHT * FIXED_ONE + 0.5);
+const fixed_t ROT_PER_COUNT_LEFT = (fixed_t)(MM_PER_COUNT_LEFT * DEG_PER_MM_DIFFERENCE * FIXED_ONE + 0.5);
+const fixed_t ROT_PER_COUNT_RIGHT = (fixed_t)(MM_PER_COUNT_RIGHT * DEG_PER_MM_DIFFERENCE * FIXED_ONE + 0.5);
+
+static volatile fixed_t s_robot_position;
+static volatile fixed_t s_robot_angle;
+
+static fixed_t s_robot_fwd_increment = 0;
+static fixed_t s_robot_rot_increment = 0;
+#else
 static volatile float s_robot_position;
 static volatile float s_robot_angle;
 
 static float s_robot_fwd_increment = 0;
 static float s_robot_rot_increment = 0;
+#endif
 
 int encoder_left_counter;
 int encoder_right_counter;
@@ -147,14 +161,53 @@ void update_encoders() {
   }
   s_left_total += left_delta;
   s_right_total += right_delta;
+#if FIXED_POINT_CONTROL
+  s_robot_fwd_increment = right_delta * FWD_PER_COUNT_RIGHT + left_delta * FWD_PER_COUNT_LEFT;
+  s_robot_rot_increment = right_delta * ROT_PER_COUNT_RIGHT - left_delta * ROT_PER_COUNT_LEFT;
+#else
   float left_change = left_delta * MM_PER_COUNT_LEFT;
   float right_change = right_delta * MM_PER_COUNT_RIGHT;
   s_robot_fwd_increment = 0.5 * (right_change + left_change);
   s_robot_rot_increment = (right_change - left_change) * DEG_PER_MM_DIFFERENCE;
+#endif
   s_robot_position += s_robot_fwd_increment;
   s_robot_angle += s_robot_rot_increment;
 }
 
+#if FIXED_POINT_CONTROL
+float robot_position() {
+  fixed_t distance;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { distance = s_robot_position; }
+  return from_fixed(distance);
+}
+
+float robot_fwd_increment() {
+  fixed_t distance;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { distance = s_robot_fwd_increment; }
+  return from_fixed(distance);
+}
+
+float robot_rot_increment() {
+  fixed_t distance;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { distance = s_robot_rot_increment; }
+  return from_fixed(distance);
+}
+
+float robot_angle() {
+  fixed_t angle;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { angle = s_robot_angle; }
+  return from_fixed(angle);
+}
+
+// only for the motor controllers in systick
+fixed_t robot_fwd_increment_fixed() {
+  return s_robot_fwd_increment;
+}
+
+fixed_t robot_rot_increment_fixed() {
+  return s_robot_rot_increment;
+}
+#else
 float robot_position() {
   float distance;
   ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { distance = s_robot_position; }
@@ -178,6 +231,7 @@ float robot_angle() {
   ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { angle = s_robot_angle; }
   return angle;
 }
+#endif
 
 uint32_t encoder_left_total() {
   return s_left_total;
@@ -33,6 +33,8 @@
 #ifndef ENCODERS_H
 #define ENCODERS_H
 
+#include "config.h"
+#include "fixed.h"
 #include <stdint.h>
 
 uint32_t encoder_left_total();
@@ -48,4 +50,9 @@ float robot_rot_increment();
 float robot_position();
 float robot_angle();
 
+#if FIXED_POINT_CONTROL
+fixed_t robot_fwd_increment_fixed();
+fixed_t robot_rot_increment_fixed();
+#endif
+
 #endif
\ No newline at end of file
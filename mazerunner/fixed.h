@@ -0,0 +1,66 @@
+/*
+ * File: fixed.h
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <stdint.h>
+
+/***
+ * The ATmega328 has no floating point hardware. Every float add or
+ * multiply in the systick ISR is a library call costing a hundred or more
+ * cycles. With FIXED_POINT_CONTROL set, the control chain works in scaled
+ * integers instead:
+ *
+ *  - Q16.16 for positions, increments and volts. The range is +/- 32767
+ *    with a resolution of about 0.000015.
+ *  - Q8.24 for profile speeds, which are kept as units per tick rather
+ *    than units per second. Adding the speed to the position is then just
+ *    a shift and an add.
+ *  - Q8.8 for the controller gains.
+ *
+ * Conversions to and from float belong in the foreground code, where the
+ * time does not matter so much.
+ */
+typedef int32_t fixed_t;
+
+const float FIXED_ONE = 65536.0f;
+
+inline fixed_t to_fixed(float x) {
+  return (fixed_t)(x * FIXED_ONE + (x < 0 ? -0.5f : 0.5f));
+}
+
+inline float from_fixed(fixed_t x) {
+  return x * (1.0f / FIXED_ONE);
+}
+
+inline fixed_t fixed_abs(fixed_t x) {
+  return (x < 0) ? -x : x;
+}
+
+#endif
@@ -25,20 +25,290 @@
  **************************************************************************/
 
 #include "maze.h"
+#include "config.h"
+#include "dstar.h"
+#include "mouse.h"
+#include "profile.h"
 #include "queue.h"
+#include "turns.h"
 #include <avr/pgmspace.h>
 
-uint8_t cost[MAZE_CELLS];
+uint16_t cost[MAZE_CELLS];
 uint8_t walls[MAZE_CELLS] __attribute__((section(".noinit"))); // the maze walls are preserved after a reset
 
-static uint8_t s_goal = GOAL;
+static_assert(GOAL_CELLS == 1 || GOAL_CELLS == 4, "GOAL_CELLS must be 1 or 4");
+static_assert(GOAL < MAZE_CELLS, "the goal must be inside the maze");
+// cells go up the columns so the area must not wrap over the top or off the east side
+static_assert(GOAL_CELLS == 1 || ((GOAL % MAZE_WIDTH) < MAZE_WIDTH - 1 && (GOAL / MAZE_WIDTH) < MAZE_WIDTH - 1),
+              "the 2x2 goal area must fit inside the maze");
+#if GOAL_CELLS == 1
+static cell_t s_goal[MAX_GOAL_CELLS] = {GOAL};
+#else
+static cell_t s_goal[MAX_GOAL_CELLS] = {GOAL, GOAL + 1, GOAL + MAZE_WIDTH, GOAL + MAZE_WIDTH + 1};
+#endif
+static uint8_t s_goal_count = GOAL_CELLS;
 
-void set_maze_goal(uint8_t goal_cell) {
-  s_goal = goal_cell;
+/***
+ * The incremental flood needs to know which target the cost array was
+ * last flooded for and which walls have been added since then. If too
+ * many walls arrive between floods, or a wall is removed, the record is
+ * abandoned and the next update will perform a full flood.
+ */
+const int MAX_NEW_WALLS = 8;
+static cell_t s_flood_target;
+static bool s_flood_valid = false;
+static bool s_flood_exact = false;
+static bool s_exact_target = false;
+static uint8_t s_new_wall_count;
+static cell_t s_new_wall_cell[MAX_NEW_WALLS];
+static uint8_t s_new_wall_direction[MAX_NEW_WALLS];
+
+/***
+ * The flood queues live on the stack and only exist while a flood is in
+ * progress. Every flood leaves behind the largest number of items its
+ * queue held so that the capacity can be checked from the CLI. The total
+ * number of cells added to flood queues is kept for benchmarking.
+ *
+ * A flood queue only ever holds the edge of the flooded region, which is
+ * much smaller than the maze. A 32x32 maze gets a queue twice as long.
+ * 'make check' in tools/host simulates complete searches of the maze
+ * files and of several hundred generated mazes and fails if any flood
+ * queue fills. A contrived maze could still fill the queue so every
+ * flood checks for that and goes back for the cells that did not fit. The costs come out
+ * the same, only slower. The exception is the weighted flood, where the
+ * estimate depends on the order the cells are taken in, but it is still
+ * a valid estimate. The number of times a queue fills is counted.
+ */
+#if MAZE_WIDTH > 16
+#define FLOOD_QUEUE_LENGTH 128
+#else
+#define FLOOD_QUEUE_LENGTH 64
+#endif
+static_assert(FLOOD_QUEUE_LENGTH >= MAX_GOAL_CELLS, "the flood queue must hold all the goal cells");
+typedef Queue<cell_t, FLOOD_QUEUE_LENGTH> FloodQueue;
+static uint16_t s_flood_queue_high_water = 0;
+static uint32_t s_flood_queue_pushes = 0;
+static uint16_t s_flood_queue_overflows = 0;
+
+static void record_queue_stats(FloodQueue &queue) {
+  if (queue.high_water() > s_flood_queue_high_water) {
+    s_flood_queue_high_water = queue.high_water();
+  }
+  s_flood_queue_pushes += queue.added();
+}
+
+int flood_queue_high_water() {
+  return s_flood_queue_high_water;
+}
+
+int flood_queue_capacity() {
+  return FLOOD_QUEUE_LENGTH;
+}
+
+int flood_queue_overflows() {
+  return s_flood_queue_overflows;
+}
+
+/***
+ * True if the queue has dropped any cells since the last call. The flag
+ * is cleared ready for the flood to go back for them.
+ */
+static bool take_overflow(FloodQueue &queue) {
+  if (!queue.overflowed()) {
+    return false;
+  }
+  queue.clear_overflow();
+  s_flood_queue_overflows++;
+  return true;
+}
+
+uint32_t flood_queue_pushes() {
+  return s_flood_queue_pushes;
+}
+
+static void record_downhill_directions();
+static bool is_known_exit(cell_t cell, uint8_t direction);
+
+/***
+ * A cell that did not fit in the queue of a cell counting flood has its
+ * cost but its neighbours were never looked at. Once the queue is empty,
+ * this queues every cell that could still lower the cost of a neighbour
+ * so that the flood can carry on. Cells with zero cost are skipped. They
+ * are either targets, which always fit in the queue, or stand-ins for
+ * excluded and pruned cells.
+ *
+ * @return true if any cells were queued
+ */
+static bool requeue_unsettled(FloodQueue &queue, bool known_exits_only) {
+  if (!take_overflow(queue)) {
+    return false;
+  }
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    uint16_t here = cost[i];
+    if (here == 0 || here == MAX_COST) {
+      continue;
+    }
+    for (uint8_t direction = 0; direction < 4; direction++) {
+      bool open = known_exits_only ? is_known_exit(i, direction) : is_exit(i, direction);
+      if (open && cost[neighbour(i, direction)] > here + 1) {
+        queue.add(i);
+        break;
+      }
+    }
+  }
+  return queue.size() > 0;
+}
+
+/***
+ * Some floods mark each cell while it waits in the queue. A cell that did
+ * not fit keeps its mark so, once the queue is empty, the cells still
+ * marked are the ones that were left out. Queue them again.
+ *
+ * @return true if any cells were queued
+ */
+static bool requeue_marked(FloodQueue &queue, const uint8_t *marked) {
+  if (!take_overflow(queue)) {
+    return false;
+  }
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    if (marked[i / 8] & (1 << (i % 8))) {
+      queue.add(i);
+    }
+  }
+  return queue.size() > 0;
+}
+
+/***
+ * Cells that can never be on a shortest route are pruned during a search.
+ * One bit per cell. See prune_maze().
+ */
+static uint8_t s_pruned[MAZE_CELLS / 8];
+static uint16_t s_pruned_count = 0;
+
+static bool is_pruned(cell_t cell) {
+  return (s_pruned[cell / 8] & (1 << (cell % 8))) != 0;
+}
+
+/***
+ * The queue floods treat a pruned cell just like an excluded cell. It is
+ * given zero cost before the flood so that it is never entered and gets
+ * MAX_COST afterwards.
+ */
+static void set_pruned_costs(uint16_t value) {
+  if (s_pruned_count == 0) {
+    return;
+  }
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    if (is_pruned(i)) {
+      cost[i] = value;
+    }
+  }
+}
+
+/***
+ * Anything that changes the walls behind the back of set_wall_present()
+ * must call this so that the next update is a full flood.
+ */
+void invalidate_flood() {
+  s_flood_valid = false;
+}
+
+static void record_new_wall(cell_t cell, uint8_t direction) {
+  if (!s_flood_valid) {
+    return;
+  }
+  if (s_new_wall_count >= MAX_NEW_WALLS) {
+    invalidate_flood();
+    return;
+  }
+  s_new_wall_cell[s_new_wall_count] = cell;
+  s_new_wall_direction[s_new_wall_count] = direction;
+  s_new_wall_count++;
+}
+
+/***
+ * The goal is an area of up to MAX_GOAL_CELLS cells. By default it is
+ * set by GOAL and GOAL_CELLS in maze.h, normally the four cells in the
+ * centre of the maze. A contest maze has a 2x2
+ * goal area and the run is over as soon as the mouse enters any of them.
+ *
+ * Changing the goal means that any existing flood is out of date.
+ */
+void set_maze_goal(const cell_t *cells, uint8_t count) {
+  if (count == 0) {
+    return;
+  }
+  if (count > MAX_GOAL_CELLS) {
+    count = MAX_GOAL_CELLS;
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    s_goal[i] = cells[i];
+  }
+  s_goal_count = count;
+  invalidate_flood();
+}
+
+void set_maze_goal(cell_t goal_cell) {
+  set_maze_goal(&goal_cell, 1);
+}
+
+/***
+ * Returns the first of the goal cells. Flooding to this cell, or to any
+ * other goal cell, floods to the whole goal area.
+ */
+cell_t maze_goal() {
+  return s_goal[0];
 }
 
-uint8_t maze_goal() {
-  return s_goal;
+uint8_t maze_goal_count() {
+  return s_goal_count;
+}
+
+cell_t maze_goal_cell(uint8_t index) {
+  return s_goal[index];
+}
+
+bool is_goal(cell_t cell) {
+  for (uint8_t i = 0; i < s_goal_count; i++) {
+    if (s_goal[i] == cell) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/***
+ * A target that is one of the goal cells stands for the whole goal area
+ * so arriving in any goal cell counts. Any other target is just the
+ * one cell.
+ */
+bool is_target(cell_t cell, cell_t target) {
+  return cell == target || (!s_exact_target && is_goal(target) && is_goal(cell));
+}
+
+/***
+ * An exploring mouse may need to get to an unvisited goal cell while it
+ * is already in the goal area. While this is set, every target is just
+ * the one cell, for is_target() and for the floods. maze_is_solved() and
+ * nearest_frontier_cell() still flood to the whole goal area.
+ */
+void set_exact_target(bool exact) {
+  s_exact_target = exact;
+}
+
+/***
+ * Fill the list with the cells that a flood to the target starts from
+ * and return how many there are.
+ */
+static uint8_t target_cells(cell_t target, cell_t *cells) {
+  if (s_exact_target || !is_goal(target)) {
+    cells[0] = target;
+    return 1;
+  }
+  for (uint8_t i = 0; i < s_goal_count; i++) {
+    cells[i] = s_goal[i];
+  }
+  return s_goal_count;
 }
 
 /***
@@ -46,12 +316,17 @@ uint8_t maze_goal() {
  * so that it is consistent when seen from the neighbouring cell.
  *
  * The wall is set unconditionally regardless of whether there is
- * already a wall present
+ * already a wall present. Walls that were not already present are
+ * remembered so that update_flood() can repair the costs around them.
  *
  * No check is made on the provided value for direction
  */
-void set_wall_present(uint8_t cell, uint8_t direction) {
+void set_wall_present(cell_t cell, uint8_t direction) {
   uint16_t nextCell = neighbour(cell, direction);
+  bool changed = is_exit(cell, direction);
+  if (changed) {
+    record_new_wall(cell, direction);
+  }
   switch (direction) {
     case NORTH:
       walls[cell] |= (1 << NORTH);
@@ -72,6 +347,11 @@ void set_wall_present(uint8_t cell, uint8_t direction) {
     default:; // do nothing - although this is an error
       break;
   }
+#if DSTAR_PLANNER
+  if (changed) {
+    dstar_wall_changed(cell, nextCell);
+  }
+#endif
 }
 
 /***
@@ -83,9 +363,16 @@ void set_wall_present(uint8_t cell, uint8_t direction) {
  *
  * No check is made on the provided value for direction. Take care not
  * to clear walls around maze boundary.
+ *
+ * Removing a wall can only make costs smaller and the incremental
+ * flood cannot deal with that so the next update will be a full flood.
  */
-void set_wall_absent(uint8_t cell, uint8_t direction) {
+void set_wall_absent(cell_t cell, uint8_t direction) {
   uint16_t nextCell = neighbour(cell, direction);
+#if DSTAR_PLANNER
+  bool changed = is_wall(cell, direction);
+#endif
+  invalidate_flood();
   switch (direction) {
     case NORTH:
       walls[cell] &= ~(1 << NORTH);
@@ -106,6 +393,11 @@ void set_wall_absent(uint8_t cell, uint8_t direction) {
     default:; // do nothing - although this is an error
       break;
   }
+#if DSTAR_PLANNER
+  if (changed) {
+    dstar_wall_changed(cell, nextCell);
+  }
+#endif
 }
 
 /***
@@ -116,6 +408,8 @@ void set_wall_absent(uint8_t cell, uint8_t direction) {
  *
  */
 void initialise_maze(const uint8_t *testMaze = nullptr) {
+  invalidate_flood();
+  clear_pruned_cells();
   for (int i = 0; i < MAZE_CELLS; i++) {
     cost[i] = 0;
     walls[i] = 0;
@@ -136,27 +430,31 @@ void initialise_maze(const uint8_t *testMaze = nullptr) {
   set_wall_absent(START, NORTH);
 }
 
-uint8_t cell_north(uint8_t cell) {
-  uint8_t nextCell = (cell + (1));
+/***
+ * Neighbours wrap around the edges of the maze. The mask is free for a
+ * 16x16 maze because the arithmetic wraps in a single byte anyway.
+ */
+cell_t cell_north(cell_t cell) {
+  cell_t nextCell = (cell + (1)) & (MAZE_CELLS - 1);
   return nextCell;
 }
 
-uint8_t cell_east(uint8_t cell) {
-  uint8_t nextCell = (cell + (MAZE_WIDTH));
+cell_t cell_east(cell_t cell) {
+  cell_t nextCell = (cell + (MAZE_WIDTH)) & (MAZE_CELLS - 1);
   return nextCell;
 }
 
-uint8_t cell_south(uint8_t cell) {
-  uint8_t nextCell = (cell + (MAZE_CELLS - 1));
+cell_t cell_south(cell_t cell) {
+  cell_t nextCell = (cell + (MAZE_CELLS - 1)) & (MAZE_CELLS - 1);
   return nextCell;
 }
 
-uint8_t cell_west(uint8_t cell) {
-  uint8_t nextCell = (cell + (MAZE_CELLS - MAZE_WIDTH));
+cell_t cell_west(cell_t cell) {
+  cell_t nextCell = (cell + (MAZE_CELLS - MAZE_WIDTH)) & (MAZE_CELLS - 1);
   return nextCell;
 }
 
-uint8_t neighbour(uint8_t cell, uint8_t direction) {
+cell_t neighbour(cell_t cell, uint8_t direction) {
   uint16_t next;
   switch (direction) {
     case NORTH:
@@ -180,8 +478,8 @@ uint8_t neighbour(uint8_t cell, uint8_t direction) {
 /***
  * Assumes the maze has been flooded
  */
-uint8_t neighbour_cost(uint8_t cell, uint8_t direction) {
-  uint8_t result = MAX_COST;
+uint16_t neighbour_cost(cell_t cell, uint8_t direction) {
+  uint16_t result = MAX_COST;
   uint8_t wallData = walls[cell];
   switch (direction) {
     case NORTH:
@@ -211,6 +509,62 @@ uint8_t neighbour_cost(uint8_t cell, uint8_t direction) {
   return result;
 }
 
+/***
+ * Any complete flood leaves the cost array correct for the target and
+ * ready for incremental updates.
+ */
+static void flood_complete(cell_t target) {
+  s_flood_target = target;
+  s_flood_exact = s_exact_target;
+  s_new_wall_count = 0;
+  s_flood_valid = true;
+}
+
+/***
+ * The queue flood does the work for several of the floods below. An
+ * excluded cell is given zero cost before the flood starts so that it
+ * looks finished and is never entered. That costs nothing in the inner
+ * loop. It gets MAX_COST at the end. Pass -1 to exclude nothing.
+ * Pruned cells are left out in the same way.
+ */
+static void flood_queue(cell_t target, int excluded) {
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    cost[i] = MAX_COST;
+  }
+  set_pruned_costs(0);
+  if (excluded >= 0) {
+    cost[excluded] = 0;
+  }
+  FloodQueue queue;
+  cell_t seeds[MAX_GOAL_CELLS];
+  uint8_t seed_count = target_cells(target, seeds);
+  for (uint8_t i = 0; i < seed_count; i++) {
+    cost[seeds[i]] = 0;
+    queue.add(seeds[i]);
+  }
+  do {
+    while (queue.size() > 0) {
+      cell_t here = queue.head();
+      uint16_t newCost = cost[here] + 1;
+
+      for (uint8_t direction = 0; direction < 4; direction++) {
+        if (is_exit(here, direction)) {
+          uint16_t nextCell = neighbour(here, direction);
+          if (cost[nextCell] > newCost) {
+            cost[nextCell] = newCost;
+            queue.add(nextCell);
+          }
+        }
+      }
+    }
+  } while (requeue_unsettled(queue, false));
+  if (excluded >= 0) {
+    cost[excluded] = MAX_COST;
+  }
+  set_pruned_costs(MAX_COST);
+  record_queue_stats(queue);
+}
+
 /***
  * Very simple cell counting flood fills cost array with the
  * manhattan distance from every cell to the target.
@@ -218,30 +572,791 @@ uint8_t neighbour_cost(uint8_t cell, uint8_t direction) {
  * Although the queue looks complicated, this is a fast flood that
  * examines each accessible cell exactly once. Consequently, it runs
  * in fairly constant time, taking 5.3ms when there are no interrupts.
+ * Test 24 measures it on the current maze and on the sample mazes.
+ *
+ * @param target - the cell from which all distances are calculated
+ */
+void flood_maze_queue(cell_t target) {
+  flood_queue(target, -1);
+  flood_complete(target);
+}
+
+/***
+ * A flood that acts as if the given cell were not in the maze at all.
+ * Every other cell gets the length of the shortest route that avoids it.
+ * The excluded cell is left with MAX_COST.
+ *
+ * The cost array is not suitable for update_flood() afterwards.
+ *
+ * @param target - the cell from which all distances are calculated
+ * @param excluded - the cell to leave out. Must not be a target cell.
+ */
+void flood_maze_excluding(cell_t target, cell_t excluded) {
+  flood_queue(target, excluded);
+  invalidate_flood();
+}
+
+/***
+ * When the mouse reaches the sensing point for a cell, the only walls that
+ * can change are the left, front and right walls of that cell. A route
+ * from the cell never needs to pass back through it. So, with a flood
+ * that excludes the cell, the choice of exit for each of the eight
+ * possible wall combinations can be worked out in advance. The result is
+ * the same as direction_to_smallest() would give after a full flood.
+ *
+ * The table is indexed by the walls that will be seen. Bit 0 is the left
+ * wall, bit 1 the front wall and bit 2 the right wall. Each entry holds
+ * the new heading or NO_ROUTE.
+ *
+ * @param target - where the mouse is heading
+ * @param cell - the cell the mouse is about to enter
+ * @param heading - the direction the mouse will be facing as it enters
+ * @param plan - table of eight headings to be filled
+ */
+void plan_decisions(cell_t target, cell_t cell, uint8_t heading, uint8_t *plan) {
+  flood_maze_excluding(target, cell);
+  const uint8_t order[4] = {heading, DtoR[heading], DtoL[heading], DtoB[heading]};
+  const uint8_t sensed[4] = {2, 4, 1, 0}; // wall bit for ahead, right, left and behind
+  for (uint8_t walls_seen = 0; walls_seen < 8; walls_seen++) {
+    uint8_t best = NO_ROUTE;
+    uint16_t smallest = MAX_COST;
+    for (uint8_t i = 0; i < 4; i++) {
+      uint8_t direction = order[i];
+      if ((walls_seen & sensed[i]) || !is_exit(cell, direction)) {
+        continue;
+      }
+      uint16_t next_cost = cost[neighbour(cell, direction)];
+      if (next_cost < smallest) {
+        smallest = next_cost;
+        best = direction;
+      }
+    }
+    plan[walls_seen] = best;
+  }
+}
+
+/***
+ * A wall is known once the mouse has been in the cell on either side of
+ * it. Until then, the absence of a wall in the map is only a guess.
+ */
+static bool is_known_exit(cell_t cell, uint8_t direction) {
+  if (!is_exit(cell, direction)) {
+    return false;
+  }
+  return cell_is_visited(cell) || cell_is_visited(neighbour(cell, direction));
+}
+
+/***
+ * The same as the queue flood except that any wall that has not been seen
+ * is treated as present. Only cells that the mouse can definitely reach
+ * through known openings get a cost.
+ *
+ * The ordinary flood treats unknown walls as absent so its costs can only
+ * be the same or smaller. When the two agree at the start, the mouse has
+ * already seen a route that is as short as any route can be.
+ *
+ * The cost array is not suitable for update_flood() afterwards.
  *
  * @param target - the cell from which all distances are calculated
  */
-void flood_maze(uint8_t target) {
+void flood_maze_closed(cell_t target) {
   for (int i = 0; i < MAZE_CELLS; i++) {
     cost[i] = MAX_COST;
   }
-  Queue<uint8_t> queue;
-  cost[target] = 0;
-  queue.add(target);
-  while (queue.size() > 0) {
-    uint8_t here = queue.head();
-    uint16_t newCost = cost[here] + 1;
+  FloodQueue queue;
+  cell_t seeds[MAX_GOAL_CELLS];
+  uint8_t seed_count = target_cells(target, seeds);
+  for (uint8_t i = 0; i < seed_count; i++) {
+    cost[seeds[i]] = 0;
+    queue.add(seeds[i]);
+  }
+  do {
+    while (queue.size() > 0) {
+      cell_t here = queue.head();
+      uint16_t newCost = cost[here] + 1;
+      for (uint8_t direction = 0; direction < 4; direction++) {
+        if (is_known_exit(here, direction)) {
+          cell_t nextCell = neighbour(here, direction);
+          if (cost[nextCell] > newCost) {
+            cost[nextCell] = newCost;
+            queue.add(nextCell);
+          }
+        }
+      }
+    }
+  } while (requeue_unsettled(queue, true));
+  record_queue_stats(queue);
+  invalidate_flood();
+}
+
+/***
+ * The search is finished when the shortest route from the start to the
+ * goal is the same length whether the unknown walls are treated as
+ * present or absent. Exploring any more cells cannot find a better route.
+ *
+ * Leaves the cost array flooded to the goal with unknown walls absent.
+ */
+bool maze_is_solved() {
+  bool exact = s_exact_target;
+  s_exact_target = false;
+  flood_maze_closed(maze_goal());
+  uint16_t closed_cost = cost[START];
+  flood_maze(maze_goal());
+  s_exact_target = exact;
+  return closed_cost != MAX_COST && closed_cost == cost[START];
+}
+
+/***
+ * Mark the neighbours of a cell that are one step further along a
+ * shortest route to the goal and queue them.
+ */
+static void extend_route(cell_t here, uint8_t *on_route, FloodQueue &queue) {
+  for (uint8_t direction = 0; direction < 4; direction++) {
+    cell_t next = neighbour(here, direction);
+    if (is_exit(here, direction) && cost[next] + 1 == cost[here] && (on_route[next / 8] & (1 << (next % 8))) == 0) {
+      on_route[next / 8] |= 1 << (next % 8);
+      queue.add(next);
+    }
+  }
+}
+
+/***
+ * Mark every cell on a shortest route from the start, following the costs
+ * of a flood to the goal. The queue is gone again before the caller needs
+ * to flood. If the queue fills, every marked cell is extended again. That
+ * picks up the cells that did not fit.
+ */
+static void mark_best_routes(uint8_t *on_route) {
+  FloodQueue queue;
+  on_route[START / 8] |= 1 << (START % 8);
+  queue.add(START);
+  for (;;) {
+    while (queue.size() > 0) {
+      extend_route(queue.head(), on_route, queue);
+    }
+    if (!take_overflow(queue)) {
+      break;
+    }
+    for (int i = 0; i < MAZE_CELLS; i++) {
+      if (on_route[i / 8] & (1 << (i % 8))) {
+        extend_route(i, on_route, queue);
+      }
+    }
+  }
+  record_queue_stats(queue);
+}
 
+/***
+ * Until the maze is solved, the best possible routes from the start to
+ * the goal pass through cells that have not been visited. Those are the
+ * cells that matter. There may be several routes of the same length and
+ * any of them could turn out to be the real one so the cells on all of
+ * them are candidates.
+ *
+ * After a flood to the goal, a cell is on a shortest route from the start
+ * if it can be reached from the start by steps that each go exactly one
+ * lower in cost. Those cells are marked by following every such step
+ * outwards from the start. Then a flood from the given cell picks the
+ * unvisited candidate that is the fewest cells away. The given cell
+ * itself is never chosen because the mouse will have seen it by then.
+ * Another goal cell can be chosen when the mouse is in the goal area, so
+ * the mouse must use set_exact_target() to get there.
+ *
+ * Leaves the cost array flooded from the given cell.
+ *
+ * @param near - pick the candidate closest to this cell
+ * @param cell - set to the chosen cell
+ * @return true if there is an unvisited cell on any best route
+ */
+bool nearest_frontier_cell(cell_t near, cell_t *cell) {
+  bool exact = s_exact_target;
+  s_exact_target = false;
+  flood_maze(maze_goal());
+  if (cost[START] == MAX_COST) {
+    s_exact_target = exact;
+    return false;
+  }
+  uint8_t on_route[MAZE_CELLS / 8] = {0}; // one bit per cell
+  mark_best_routes(on_route);
+  // the distances are from the one cell even if it is in the goal area
+  s_exact_target = true;
+  flood_maze(near);
+  s_exact_target = exact;
+  bool found = false;
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    if ((on_route[i / 8] & (1 << (i % 8))) == 0 || cell_is_visited(i) || cost[i] == MAX_COST || i == near) {
+      continue;
+    }
+    if (!found || cost[i] < cost[*cell]) {
+      found = true;
+      *cell = i;
+    }
+  }
+  return found;
+}
+
+static bool is_terminal(cell_t cell, cell_t target, cell_t keep) {
+  return cell == START || cell == keep || is_target(cell, target) || is_goal(cell);
+}
+
+/***
+ * Count the exits from a cell into cells that have not been pruned.
+ * Unseen walls count as exits. The direction of the last one found is
+ * returned through the pointer.
+ */
+static uint8_t live_exits(cell_t cell, uint8_t *direction) {
+  uint8_t count = 0;
+  for (uint8_t d = 0; d < 4; d++) {
+    if (is_exit(cell, d) && !is_pruned(neighbour(cell, d))) {
+      *direction = d;
+      count++;
+    }
+  }
+  return count;
+}
+
+static void mark_pruned(cell_t cell) {
+  s_pruned[cell / 8] |= 1 << (cell % 8);
+  s_pruned_count++;
+}
+
+/***
+ * Mark the neighbours of a cell that can be reached without going through
+ * a pruned cell and queue them. As in mark_best_routes(), a full queue is
+ * dealt with by extending every marked cell again.
+ */
+static void extend_reachable(cell_t here, uint8_t *reachable, FloodQueue &queue) {
+  for (uint8_t d = 0; d < 4; d++) {
+    cell_t next = neighbour(here, d);
+    if (is_exit(here, d) && !is_pruned(next) && (reachable[next / 8] & (1 << (next % 8))) == 0) {
+      reachable[next / 8] |= 1 << (next % 8);
+      queue.add(next);
+    }
+  }
+}
+
+/***
+ * A shortest route between two cells never goes into a dead end because
+ * it would have to come straight back out again. A cell with only one
+ * way in is a dead end unless it is one of the ends of the route. Once
+ * it is pruned, the cell leading to it may become a dead end in turn so
+ * the whole of a dead-end corridor, and any tree of corridors behind it,
+ * is pruned.
+ *
+ * Then any cell that cannot be reached from the start, the goal, the
+ * target or the keep cell is pruned as well.
+ *
+ * Only walls already in the map are used and unseen walls are taken to be
+ * open so a pruned cell stays pruned as the search adds more walls. A
+ * dead-end region that contains a loop is not pruned.
+ *
+ * The queue floods and the bitboard flood leave pruned cells out so they
+ * do less work. The costs of all the other cells are unchanged.
+ *
+ * Pruning the same target again, as the search does at every cell, only
+ * ever adds cells to the pruned set. Then the current flood stays valid.
+ * The newly pruned cells get MAX_COST and the repair in update_flood()
+ * checks the cells next to them just as if a wall had been added. If any
+ * cell comes out of the pruned set, or the target has changed, the next
+ * update is a full flood.
+ *
+ * @param target - the cell being flooded to. Never pruned.
+ * @param keep - usually the cell the mouse is in. Never pruned.
+ * @return the number of cells pruned
+ */
+int prune_maze(cell_t target, cell_t keep) {
+  uint8_t was_pruned[MAZE_CELLS / 8];
+  for (int i = 0; i < MAZE_CELLS / 8; i++) {
+    was_pruned[i] = s_pruned[i];
+  }
+  clear_pruned_cells();
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    cell_t cell = i;
+    while (!is_pruned(cell) && !is_terminal(cell, target, keep)) {
+      uint8_t direction = 0;
+      uint8_t exits = live_exits(cell, &direction);
+      if (exits > 1) {
+        break;
+      }
+      mark_pruned(cell);
+      if (exits == 0) {
+        break;
+      }
+      cell = neighbour(cell, direction); // the only cell that may now be a dead end
+    }
+  }
+  uint8_t reachable[MAZE_CELLS / 8] = {0};
+  FloodQueue queue;
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    if (!is_pruned(i) && is_terminal(i, target, keep)) {
+      reachable[i / 8] |= 1 << (i % 8);
+      queue.add(i);
+    }
+  }
+  for (;;) {
+    while (queue.size() > 0) {
+      extend_reachable(queue.head(), reachable, queue);
+    }
+    if (!take_overflow(queue)) {
+      break;
+    }
+    for (int i = 0; i < MAZE_CELLS; i++) {
+      if (reachable[i / 8] & (1 << (i % 8))) {
+        extend_reachable(i, reachable, queue);
+      }
+    }
+  }
+  record_queue_stats(queue);
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    if (!is_pruned(i) && (reachable[i / 8] & (1 << (i % 8))) == 0) {
+      mark_pruned(i);
+    }
+  }
+  if (!s_flood_valid || target != s_flood_target || s_flood_exact != s_exact_target) {
+    invalidate_flood();
+    return s_pruned_count;
+  }
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    if ((was_pruned[i / 8] & (1 << (i % 8))) != 0 && !is_pruned(i)) {
+      invalidate_flood();
+      return s_pruned_count;
+    }
+  }
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    if (is_pruned(i) && cost[i] != MAX_COST) {
+      cost[i] = MAX_COST;
+      for (uint8_t d = 0; d < 4; d++) {
+        if (is_exit(i, d) && !is_pruned(neighbour(i, d))) {
+          record_new_wall(i, d);
+        }
+      }
+    }
+  }
+  return s_pruned_count;
+}
+
+void clear_pruned_cells() {
+  for (int i = 0; i < MAZE_CELLS / 8; i++) {
+    s_pruned[i] = 0;
+  }
+  s_pruned_count = 0;
+}
+
+int pruned_cell_count() {
+  return s_pruned_count;
+}
+
+#if MAZE_WIDTH > 16
+typedef uint32_t column_t;
+#else
+typedef uint16_t column_t;
+#endif
+
+/***
+ * The bitboard flood produces exactly the same costs as the queue flood
+ * but works on whole columns of the maze at once.
+ *
+ * Each column of the maze is held as a word with one bit for each
+ * cell. Bit 0 is the southernmost cell. For each column there are four
+ * words that say which cells have an exit in each direction.
+ *
+ * The wavefront is the set of cells that have just been given a cost.
+ * The next wavefront is found by moving the current one one step in each
+ * direction, through the exits only, and removing any cells that already
+ * have a cost. Moving north or south is just a shift of the column word.
+ * Moving east or west takes the word from the neighbouring column.
+ *
+ * That way, a whole column of cells is dealt with in a handful of word
+ * operations.
+ * Only the columns that the wavefront can have reached are processed.
+ *
+ * Unlike the queue flood, exits through the outside of the maze do not
+ * wrap around to the other side. A maze with proper boundary walls has
+ * no such exits anyway.
+ *
+ * @param target - the cell from which all distances are calculated
+ */
+void flood_maze_bitboard(cell_t target) {
+  column_t exits[4][MAZE_WIDTH];
+  column_t reached[MAZE_WIDTH];
+  column_t front[MAZE_WIDTH];
+  for (uint8_t x = 0; x < MAZE_WIDTH; x++) {
+    for (uint8_t d = 0; d < 4; d++) {
+      exits[d][x] = 0;
+    }
+    reached[x] = 0;
+    column_t bit = 1;
+    for (uint8_t y = 0; y < MAZE_WIDTH; y++) {
+      cell_t cell = x * MAZE_WIDTH + y;
+      uint8_t wall = walls[cell];
+      cost[cell] = MAX_COST;
+      if (is_pruned(cell)) {
+        reached[x] |= bit; // never entered, just like in the queue flood
+      }
+      if (!(wall & (1 << NORTH))) {
+        exits[NORTH][x] |= bit;
+      }
+      if (!(wall & (1 << EAST))) {
+        exits[EAST][x] |= bit;
+      }
+      if (!(wall & (1 << SOUTH))) {
+        exits[SOUTH][x] |= bit;
+      }
+      if (!(wall & (1 << WEST))) {
+        exits[WEST][x] |= bit;
+      }
+      bit <<= 1;
+    }
+    front[x] = 0;
+  }
+  int8_t first = MAZE_WIDTH;
+  int8_t last = -1;
+  cell_t seeds[MAX_GOAL_CELLS];
+  uint8_t seed_count = target_cells(target, seeds);
+  for (uint8_t i = 0; i < seed_count; i++) {
+    int8_t column = seeds[i] / MAZE_WIDTH;
+    front[column] |= (column_t)1 << (seeds[i] % MAZE_WIDTH);
+    reached[column] |= front[column];
+    cost[seeds[i]] = 0;
+    first = min(first, column);
+    last = max(last, column);
+  }
+  uint16_t distance = 0;
+  while (first <= last && distance < MAX_COST - 1) {
+    distance++;
+    int8_t lo = first > 0 ? first - 1 : 0;
+    int8_t hi = last < MAZE_WIDTH - 1 ? last + 1 : MAZE_WIDTH - 1;
+    first = MAZE_WIDTH;
+    last = -1;
+    column_t from_west = 0; // wavefront that moved east out of the previous column
+    for (int8_t x = lo; x <= hi; x++) {
+      column_t old = front[x];
+      column_t from_east = 0;
+      if (x < MAZE_WIDTH - 1) {
+        from_east = front[x + 1] & exits[WEST][x + 1];
+      }
+      if ((old | from_west | from_east) == 0) {
+        continue; // nothing can arrive in this column
+      }
+      column_t next = from_west | from_east;
+      next |= (column_t)((old & exits[NORTH][x]) << 1);
+      next |= (old & exits[SOUTH][x]) >> 1;
+      from_west = old & exits[EAST][x];
+      next &= ~reached[x];
+      front[x] = next;
+      if (next == 0) {
+        continue;
+      }
+      reached[x] |= next;
+      if (x < first) {
+        first = x;
+      }
+      last = x;
+      cell_t cell = x * MAZE_WIDTH;
+      while (next) {
+        if (next & 1) {
+          cost[cell] = distance;
+        }
+        next >>= 1;
+        cell++;
+      }
+    }
+  }
+  flood_complete(target);
+}
+
+/***
+ * Flood the maze with whichever engine was selected at build time. See
+ * BITBOARD_FLOOD in maze.h
+ *
+ * If the target is one of the goal cells, all the goal cells get zero
+ * cost. That is true for all the floods.
+ *
+ * @param target - the cell from which all distances are calculated
+ */
+void flood_maze(cell_t target) {
+#if BITBOARD_FLOOD
+  flood_maze_bitboard(target);
+#else
+  flood_maze_queue(target);
+#endif
+  record_downhill_directions();
+}
+
+/***
+ * The weighted flood fills the cost array with an estimate of the time,
+ * in milliseconds, that a smooth turn speed run would take to get from
+ * each cell to the target. Long straights are cheap because the mouse
+ * can get up to speed on them. Turns are expensive.
+ *
+ * A straight of n cells is timed as a trapezoidal profile that starts
+ * and ends at SPEEDMAX_SMOOTH_TURN, with SPEEDMAX_STRAIGHT as the top
+ * speed and SEARCH_ACCELERATION. Runs longer than MAX_RUN cells just
+ * add the time for one more cell at the same rate as the last one.
+ */
+const uint8_t MAX_RUN = 15;
+
+static uint16_t profile_ms(float distance, float v_end, float v_max, float acceleration) {
+  return (uint16_t)(1000 * profile_time(distance, v_end, v_max, v_end, acceleration) + 0.5f);
+}
+
+/***
+ * The direction that each cell was reached from is packed into two
+ * bits per cell so that run lengths can be found during the flood.
+ */
+static uint8_t get_exit(const uint8_t *exits, cell_t cell) {
+  return (exits[cell / 4] >> (2 * (cell % 4))) & 0x03;
+}
+
+static void set_exit(uint8_t *exits, cell_t cell, uint8_t direction) {
+  uint8_t shift = 2 * (cell % 4);
+  exits[cell / 4] = (exits[cell / 4] & ~(0x03 << shift)) | (direction << shift);
+}
+
+/***
+ * Count the cells in the straight that starts at the given cell and
+ * heads for the target, up to MAX_RUN. The target cells have zero cost.
+ */
+static uint8_t run_length(const uint8_t *exits, cell_t cell) {
+  uint8_t length = 0;
+  uint8_t direction = get_exit(exits, cell);
+  while (cost[cell] != 0 && length < MAX_RUN && get_exit(exits, cell) == direction) {
+    cell = neighbour(cell, direction);
+    length++;
+  }
+  return length;
+}
+
+/***
+ * Like the queue flood except that the cost of each step depends on
+ * whether it extends a straight or needs a turn. Because of that, a cell
+ * may have its cost lowered after it has been processed. It is then
+ * queued again so that the improvement reaches its neighbours. A cell is
+ * never in the queue twice at the same time.
+ *
+ * The result is an estimate. A cell only knows about the best route from
+ * itself, not about how the mouse arrived there. It is, however, always
+ * true that every reachable cell has a neighbour with a smaller cost so
+ * direction_to_smallest() will always lead to the target.
+ *
+ * Costs that would not fit are left as MAX_COST. The cost array is not
+ * suitable for update_flood() afterwards so the next update will do a
+ * full flood.
+ *
+ * @param target - the cell from which all times are calculated
+ */
+void flood_maze_weighted(cell_t target) {
+  uint16_t run_time[MAX_RUN + 1];
+  for (uint8_t n = 0; n <= MAX_RUN; n++) {
+    run_time[n] = profile_ms(n * FULL_CELL, SPEEDMAX_SMOOTH_TURN, SPEEDMAX_STRAIGHT, SEARCH_ACCELERATION);
+  }
+  uint16_t turn_ms = (uint16_t)(1000 * turn_time(MOVE_RIGHT, SPEEDMAX_SMOOTH_TURN) + 0.5f);
+  uint8_t exits[MAZE_CELLS / 4];
+  uint8_t queued[MAZE_CELLS / 8] = {0}; // one bit per cell
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    cost[i] = MAX_COST;
+  }
+  FloodQueue queue;
+  cell_t seeds[MAX_GOAL_CELLS];
+  uint8_t seed_count = target_cells(target, seeds);
+  for (uint8_t i = 0; i < seed_count; i++) {
+    cost[seeds[i]] = 0;
+    queue.add(seeds[i]);
+  }
+  do {
+    while (queue.size() > 0) {
+      cell_t here = queue.head();
+      queued[here / 8] &= ~(1 << (here % 8));
+      bool is_end = cost[here] == 0;
+      uint8_t run = 0;
+      uint8_t exit = 0;
+      if (!is_end) {
+        run = run_length(exits, here);
+        exit = get_exit(exits, here);
+      }
+      for (uint8_t direction = 0; direction < 4; direction++) {
+        if (!is_exit(here, direction)) {
+          continue;
+        }
+        uint8_t heading = DtoB[direction]; // the way the mouse moves to get here
+        uint16_t step;
+        if (is_end) {
+          step = run_time[1];
+        } else if (heading == exit && run < MAX_RUN) {
+          step = run_time[run + 1] - run_time[run];
+        } else if (heading == exit) {
+          step = run_time[MAX_RUN] - run_time[MAX_RUN - 1];
+        } else {
+          step = turn_ms + run_time[1];
+        }
+        uint32_t newCost = (uint32_t)cost[here] + step;
+        cell_t next = neighbour(here, direction);
+        if (newCost < cost[next]) {
+          cost[next] = newCost;
+          set_exit(exits, next, heading);
+          if ((queued[next / 8] & (1 << (next % 8))) == 0) {
+            queued[next / 8] |= 1 << (next % 8);
+            queue.add(next);
+          }
+        }
+      }
+    }
+  } while (requeue_marked(queue, queued));
+  record_queue_stats(queue);
+  invalidate_flood();
+  record_downhill_directions();
+}
+
+/***
+ * A cell keeps its cost only if it still has an accessible neighbour
+ * that is one step closer to the target. The target cells, with zero
+ * cost, need none.
+ */
+static bool cost_is_supported(cell_t cell) {
+  if (cost[cell] == 0) {
+    return true;
+  }
+  uint16_t needed = cost[cell] - 1;
+  for (uint8_t direction = 0; direction < 4; direction++) {
+    if (is_exit(cell, direction) && cost[neighbour(cell, direction)] == needed) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/***
+ * If the cell has lost its route downhill, mark it with MAX_COST, record
+ * it in the lost set and queue it so that its neighbours get checked.
+ */
+static void check_support(cell_t cell, uint8_t *lost, FloodQueue &queue) {
+  if (cost[cell] == MAX_COST || cost_is_supported(cell)) {
+    return;
+  }
+  cost[cell] = MAX_COST;
+  lost[cell / 8] |= 1 << (cell % 8);
+  queue.add(cell);
+}
+
+static uint16_t s_flood_repairs = 0; // updates done without a full flood
+
+/***
+ * Repair the costs around the walls added since the last flood. See
+ * update_flood(). Returns false if a full flood is needed instead. The
+ * queue is gone by then so the two are never on the stack together.
+ */
+static bool repair_flood() {
+  uint8_t lost[MAZE_CELLS / 8] = {0}; // one bit per cell
+  FloodQueue queue;
+  for (uint8_t i = 0; i < s_new_wall_count; i++) {
+    cell_t cell = s_new_wall_cell[i];
+    check_support(cell, lost, queue);
+    check_support(neighbour(cell, s_new_wall_direction[i]), lost, queue);
+  }
+  s_new_wall_count = 0;
+  if (queue.size() == 0) {
+    return true; // none of the new walls was on a shortest route
+  }
+  while (queue.size() > 0) {
+    cell_t here = queue.head();
     for (uint8_t direction = 0; direction < 4; direction++) {
       if (is_exit(here, direction)) {
-        uint16_t nextCell = neighbour(here, direction);
-        if (cost[nextCell] > newCost) {
-          cost[nextCell] = newCost;
-          queue.add(nextCell);
+        check_support(neighbour(here, direction), lost, queue);
+      }
+    }
+  }
+  if (take_overflow(queue)) {
+    record_queue_stats(queue);
+    return false;
+  }
+  // re-seed the lost region from its edges. The lost bits now double
+  // up as a record of which cells are waiting in the queue so cells
+  // already seeded here are not counted as neighbours.
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    if ((lost[i / 8] & (1 << (i % 8))) == 0) {
+      continue;
+    }
+    uint16_t smallest = MAX_COST;
+    for (uint8_t direction = 0; direction < 4; direction++) {
+      cell_t next = neighbour(i, direction);
+      if (is_exit(i, direction) && (lost[next / 8] & (1 << (next % 8))) == 0) {
+        uint16_t nextCost = cost[next];
+        if (nextCost < smallest) {
+          smallest = nextCost;
         }
       }
     }
+    if (smallest < MAX_COST - 1) {
+      cost[i] = smallest + 1;
+      queue.add(i);
+    } else {
+      lost[i / 8] &= ~(1 << (i % 8));
+    }
   }
+  do {
+    while (queue.size() > 0) {
+      cell_t here = queue.head();
+      lost[here / 8] &= ~(1 << (here % 8));
+      uint16_t newCost = cost[here] + 1;
+      for (uint8_t direction = 0; direction < 4; direction++) {
+        if (is_exit(here, direction)) {
+          cell_t next = neighbour(here, direction);
+          if (cost[next] > newCost && !is_pruned(next)) {
+            cost[next] = newCost;
+            if ((lost[next / 8] & (1 << (next % 8))) == 0) {
+              lost[next / 8] |= 1 << (next % 8);
+              queue.add(next);
+            }
+          }
+        }
+      }
+    }
+  } while (requeue_marked(queue, lost));
+  record_queue_stats(queue);
+  return true;
+}
+
+/***
+ * Bring the cost array up to date for the given target.
+ *
+ * If the last flood was for the same target and the only changes since
+ * then have been walls added by set_wall_present(), the costs are
+ * repaired around the new walls. Only cells whose distance actually
+ * changes get new costs. The result is identical to a full flood.
+ *
+ * Adding a wall can only ever make costs larger. The repair is done in
+ * two stages.
+ *
+ * First, every cell that has lost its route downhill is marked with
+ * MAX_COST. The search for these starts with the cells either side of
+ * each new wall. Losing a cell may leave its neighbours without support
+ * so they are checked in turn. Each lost cell is queued exactly once. If
+ * the queue fills, the lost region is not known for certain and there is
+ * a full flood instead.
+ *
+ * Then the lost cells on the edge of the region take their costs from the
+ * cheapest surviving neighbour and the new costs are spread back in
+ * through the lost region just as in flood_maze(). Only the edge goes in
+ * the queue to start with, which keeps it short.
+ *
+ * During a search, most new walls are not on the route to the target at
+ * all and the update is just the two support checks for each wall. Even
+ * a wall that diverts the route is typically repaired in well under 1ms.
+ *
+ * Anything else gets a full flood_maze().
+ *
+ * @param target - the cell from which all distances are calculated
+ */
+void update_flood(cell_t target) {
+  if (!s_flood_valid || target != s_flood_target || s_flood_exact != s_exact_target || !repair_flood()) {
+    flood_maze(target);
+    return;
+  }
+  s_flood_repairs++;
+}
+
+uint16_t flood_repair_count() {
+  return s_flood_repairs;
 }
 
 /***
@@ -254,7 +1369,7 @@ void flood_maze(uint8_t target) {
  * @param startDirection
  * @return
  */
-uint8_t direction_to_smallest(uint8_t cell, uint8_t startDirection) {
+uint8_t direction_to_smallest(cell_t cell, uint8_t startDirection) {
   uint8_t nextDirection = startDirection;
   uint8_t smallestDirection = INVALID_DIRECTION;
   uint16_t nextCost;
@@ -288,15 +1403,98 @@ uint8_t direction_to_smallest(uint8_t cell, uint8_t startDirection) {
   return smallestDirection;
 }
 
+/***
+ * A bit is set for every exit that leads to the cheapest neighbour, as
+ * long as that is cheaper than the cell itself. Target cells and
+ * unreachable cells have no downhill directions.
+ */
+static uint8_t downhill_mask(cell_t cell) {
+  uint16_t smallest = cost[cell];
+  uint8_t mask = 0;
+  for (uint8_t direction = 0; direction < 4; direction++) {
+    uint16_t next = neighbour_cost(cell, direction);
+    if (next < smallest) {
+      smallest = next;
+      mask = 1 << direction;
+    } else if (next == smallest && mask) {
+      mask |= 1 << direction;
+    }
+  }
+  return mask;
+}
+
+#if DOWNHILL_TABLE
+/***
+ * Each nibble holds the downhill directions for one cell.
+ */
+static uint8_t s_downhill[MAZE_CELLS / 2];
+
+/***
+ * Indexed by the downhill directions rotated so that bit 0 is straight
+ * ahead. Gives the turn, in quarter turns to the right, for the first of
+ * ahead, right, left and behind that is downhill. This is the same order
+ * that direction_to_smallest() uses to break ties.
+ */
+static const uint8_t downhill_turn[16] PROGMEM = {0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 3, 0, 1, 0};
+
+static void record_downhill_directions() {
+  for (int i = 0; i < MAZE_CELLS; i += 2) {
+    s_downhill[i / 2] = downhill_mask(i) | (downhill_mask(i + 1) << 4);
+  }
+}
+
+/***
+ * Gives the same answer as direction_to_smallest() but only looks in the
+ * table made by the last call to flood_maze() or flood_maze_weighted().
+ * That makes it several times faster. The answer will be wrong if the
+ * costs have been changed in any other way since then.
+ */
+uint8_t downhill_direction(cell_t cell, uint8_t heading) {
+  uint8_t mask = downhill_exits(cell);
+  if (mask == 0) {
+    return INVALID_DIRECTION;
+  }
+  mask = ((mask | (mask << 4)) >> heading) & 0x0F;
+  return (heading + pgm_read_byte(&downhill_turn[mask])) & 0x03;
+}
+
+/***
+ * All the directions that downhill_direction() could have chosen from,
+ * one bit for each direction. More than one bit is set where routes of
+ * the same cost split.
+ */
+uint8_t downhill_exits(cell_t cell) {
+  uint8_t mask = s_downhill[cell / 2];
+  if (cell & 1) {
+    mask >>= 4;
+  }
+  return mask & 0x0F;
+}
+#else
+static void record_downhill_directions() {
+}
+
+uint8_t downhill_exits(cell_t cell) {
+  return downhill_mask(cell);
+}
+
+uint8_t downhill_direction(cell_t cell, uint8_t heading) {
+  return direction_to_smallest(cell, heading);
+}
+#endif
+
 /***
  * Since the sample mazes are in flash memory, we cannnot simply copy
  * them without using the PROGMEM stuff
  */
 void copy_walls_from_flash(const uint8_t *src) {
+  invalidate_flood();
+  clear_pruned_cells();
   memcpy_P(walls, src, MAZE_CELLS);
 }
 
 // some sample maze data
+#if MAZE_WIDTH == 16
 const PROGMEM uint8_t emptyMaze[] = {
     0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x09,
     0x0C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
@@ -335,5 +1533,6 @@ const PROGMEM uint8_t japan2007[] = {
     0x05, 0x05, 0x05, 0x05, 0x0C, 0x09, 0x0C, 0x09, 0x06, 0x09, 0x06, 0x09, 0x06, 0x09, 0x05, 0x05,
     0x05, 0x06, 0x03, 0x06, 0x03, 0x06, 0x03, 0x06, 0x09, 0x06, 0x0A, 0x02, 0x0B, 0x06, 0x01, 0x05,
     0x06, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x02, 0x0A, 0x0A, 0x0A, 0x0A, 0x0A, 0x02, 0x03};
+#endif
 
 //--------------------------------------------------------------------------
@@ -29,11 +29,56 @@
 
 #include <stdint.h>
 
+// The maze size is set at build time. A classic maze is 16x16. Half size
+// mazes are 32x32 but those need much more RAM than the ATmega328 has.
+#ifndef MAZE_WIDTH
 #define MAZE_WIDTH 16
+#endif
 #define MAZE_CELLS (MAZE_WIDTH * MAZE_WIDTH)
-#define GOAL 0x77
+
+#if MAZE_WIDTH != 16 && MAZE_WIDTH != 32
+#error "MAZE_WIDTH must be 16 or 32"
+#endif
+#if MAZE_WIDTH > 16 && defined(__AVR_ATmega328P__)
+#error "A 32x32 maze will not fit in the RAM of an ATmega328"
+#endif
+
+// cell indices are a single byte whenever possible since that is faster
+#if MAZE_CELLS > 256
+typedef uint16_t cell_t;
+#else
+typedef uint8_t cell_t;
+#endif
+
+// The goal. With GOAL_CELLS set to 4, GOAL is the south-west corner of a
+// 2x2 goal area. 0x77 gives the four centre cells of a 16x16 maze. Set
+// GOAL_CELLS to 1 for a single goal cell at GOAL, such as a practice goal.
+// Any other goal list can be set at run time with set_maze_goal().
+#define GOAL ((MAZE_WIDTH / 2 - 1) * (MAZE_WIDTH + 1))
+#define GOAL_CELLS 4
+#define MAX_GOAL_CELLS 4
 #define START 0x00
 
+// Choose the flood engine at build time. The default is the queue based
+// flood. Set this to 1 to use the bitboard flood that works on a whole
+// column of cells at a time. Both produce the same costs.
+#ifndef BITBOARD_FLOOD
+#define BITBOARD_FLOOD 0
+#endif
+
+// flood_maze() and flood_maze_weighted() can also record which neighbours
+// of each cell are downhill so that make_path() only needs a table lookup
+// at each step. The table takes half a byte per cell.
+#ifndef DOWNHILL_TABLE
+#define DOWNHILL_TABLE 1
+#endif
+
+// Set this to 1 to have the search use the D* Lite planner in dstar.cpp
+// instead of the flood. It needs more RAM than the ATmega328 has.
+#ifndef DSTAR_PLANNER
+#define DSTAR_PLANNER 0
+#endif
+
 // directions for mapping
 #define NORTH 0
 #define EAST 1
@@ -43,52 +88,85 @@
 #define VISITED 0xF0
 
 #define INVALID_DIRECTION (0)
-#define MAX_COST 255
+#define NO_ROUTE (0xFF)
+#define MAX_COST 0xFFFF
 
+#if MAZE_WIDTH == 16
 extern const uint8_t emptyMaze[];
 extern const uint8_t japan2007[];
+#else
+// The sample mazes are all 16x16. Without one, initialise_maze() will
+// build an empty maze of any size.
+#define emptyMaze nullptr
+#endif
 
-extern uint8_t cost[MAZE_WIDTH * MAZE_WIDTH];
-extern uint8_t walls[MAZE_WIDTH * MAZE_WIDTH];
+extern uint16_t cost[MAZE_CELLS];
+extern uint8_t walls[MAZE_CELLS];
 
 // tables give new direction from current heading and next turn
 const unsigned char DtoR[] = {1, 2, 3, 0};
 const unsigned char DtoB[] = {2, 3, 0, 1};
 const unsigned char DtoL[] = {3, 0, 1, 2};
 
-inline void mark_cell_visited(uint8_t cell) {
+inline void mark_cell_visited(cell_t cell) {
   walls[cell] |= VISITED;
 }
 
-inline bool cell_is_visited(uint8_t cell) {
+inline bool cell_is_visited(cell_t cell) {
   return (walls[cell] & VISITED) == VISITED;
 }
 
-inline bool is_exit(uint8_t cell, uint8_t direction) {
+inline bool is_exit(cell_t cell, uint8_t direction) {
   return ((walls[cell] & (1 << direction)) == 0);
 }
 
-inline bool is_wall(uint8_t cell, uint8_t direction) {
+inline bool is_wall(cell_t cell, uint8_t direction) {
   return ((walls[cell] & (1 << direction)) != 0);
 }
 
-void set_maze_goal(uint8_t goal_cell);
-uint8_t maze_goal();
-
-uint8_t cell_north(uint8_t cell);
-uint8_t cell_east(uint8_t cell);
-uint8_t cell_south(uint8_t cell);
-uint8_t cell_west(uint8_t cell);
-uint8_t neighbour(uint8_t cell, uint8_t direction);
-uint8_t neighbour_cost(uint8_t cell, uint8_t direction);
-uint8_t direction_to_smallest(uint8_t cell, uint8_t startDirection);
+void set_maze_goal(cell_t goal_cell);
+void set_maze_goal(const cell_t *cells, uint8_t count);
+cell_t maze_goal();
+uint8_t maze_goal_count();
+cell_t maze_goal_cell(uint8_t index);
+bool is_goal(cell_t cell);
+bool is_target(cell_t cell, cell_t target);
+void set_exact_target(bool exact);
+
+cell_t cell_north(cell_t cell);
+cell_t cell_east(cell_t cell);
+cell_t cell_south(cell_t cell);
+cell_t cell_west(cell_t cell);
+cell_t neighbour(cell_t cell, uint8_t direction);
+uint16_t neighbour_cost(cell_t cell, uint8_t direction);
+uint8_t direction_to_smallest(cell_t cell, uint8_t startDirection);
+uint8_t downhill_direction(cell_t cell, uint8_t heading);
+uint8_t downhill_exits(cell_t cell);
 
 void copy_walls_from_flash(const uint8_t *src);
 
-void set_wall_present(uint8_t cell, uint8_t direction);
-void set_wall_absent(uint8_t cell, uint8_t direction);
+void set_wall_present(cell_t cell, uint8_t direction);
+void set_wall_absent(cell_t cell, uint8_t direction);
 
 void initialise_maze(const uint8_t *testMaze);
-void flood_maze(uint8_t target);
+void flood_maze(cell_t target);
+void flood_maze_queue(cell_t target);
+void flood_maze_bitboard(cell_t target);
+void flood_maze_weighted(cell_t target);
+void flood_maze_closed(cell_t target);
+void flood_maze_excluding(cell_t target, cell_t excluded);
+void plan_decisions(cell_t target, cell_t cell, uint8_t heading, uint8_t *plan);
+bool maze_is_solved();
+bool nearest_frontier_cell(cell_t near, cell_t *cell);
+void update_flood(cell_t target);
+uint16_t flood_repair_count();
+void invalidate_flood();
+int prune_maze(cell_t target, cell_t keep);
+void clear_pruned_cells();
+int pruned_cell_count();
+int flood_queue_high_water();
+int flood_queue_capacity();
+int flood_queue_overflows();
+uint32_t flood_queue_pushes();
 
 #endif // MAZE_H
@@ -0,0 +1,222 @@
+/*
+ * File: maze_check.cpp
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+
+#include "maze_check.h"
+#include "maze.h"
+
+/***
+ * Every sighting of a wall is a vote. Each inside wall has a two bit
+ * count that goes up when the wall is seen and down when it is not. The
+ * wall is in the map when the count is 2 or 3. The counts stop at 0 and
+ * 3 so a long history cannot outvote a few recent sightings. A wall
+ * starts at 3 or 0 so it takes two sightings the other way to change
+ * it. One misread can never remove a real wall.
+ *
+ * Only the north and east walls of each cell have a count. The others
+ * belong to the neighbouring cell. The outside walls are never counted
+ * because they are always there.
+ */
+static uint8_t s_votes[MAZE_CELLS / 2];
+static uint8_t s_problems;
+static int s_conflicts;
+static int s_repairs;
+
+static bool on_boundary(cell_t cell, uint8_t direction) {
+  switch (direction) {
+    case NORTH:
+      return (cell % MAZE_WIDTH) == MAZE_WIDTH - 1;
+    case EAST:
+      return (cell / MAZE_WIDTH) == MAZE_WIDTH - 1;
+    case SOUTH:
+      return (cell % MAZE_WIDTH) == 0;
+    default:
+      return (cell / MAZE_WIDTH) == 0;
+  }
+}
+
+// the bit position of the count for an inside wall
+static uint8_t vote_shift(cell_t &cell, uint8_t direction) {
+  if (direction == SOUTH || direction == WEST) {
+    cell = neighbour(cell, direction);
+    direction = (direction + 2) & 0x03;
+  }
+  return 4 * (cell & 1) + 2 * (direction == EAST);
+}
+
+static uint8_t get_vote(cell_t cell, uint8_t direction) {
+  uint8_t shift = vote_shift(cell, direction);
+  return (s_votes[cell / 2] >> shift) & 0x03;
+}
+
+static void set_vote(cell_t cell, uint8_t direction, uint8_t vote) {
+  uint8_t shift = vote_shift(cell, direction);
+  s_votes[cell / 2] = (s_votes[cell / 2] & ~(0x03 << shift)) | (vote << shift);
+}
+
+/***
+ * Start counting from the walls in the map. Each one is as sure as a
+ * first sighting. Call this before a search, after the map is loaded.
+ */
+void maze_check_begin() {
+  for (int cell = 0; cell < MAZE_CELLS; cell++) {
+    set_vote(cell, NORTH, is_wall(cell, NORTH) ? 3 : 0);
+    set_vote(cell, EAST, is_wall(cell, EAST) ? 3 : 0);
+  }
+  s_problems = 0;
+  s_conflicts = 0;
+  s_repairs = 0;
+}
+
+/***
+ * Record one sighting of a wall, present or not, and update the map.
+ *
+ * A wall is known once the mouse has been in the cell on either side.
+ * The first sighting of an unknown wall just goes into the map. A
+ * sighting that disagrees with a known wall is a conflict. The count
+ * then decides and the map is repaired if the majority has changed.
+ *
+ * This is called for each wall the mouse sees, at the sensing point, so
+ * it does a fixed, small amount of work.
+ */
+void maze_check_observe(cell_t cell, uint8_t direction, bool present) {
+  if (on_boundary(cell, direction)) {
+    if (!present) {
+      s_conflicts++;
+    }
+    return;
+  }
+  bool known = cell_is_visited(cell) || cell_is_visited(neighbour(cell, direction));
+  uint8_t vote = get_vote(cell, direction);
+  if (!known) {
+    vote = present ? 3 : 0;
+  } else {
+    if (present != is_wall(cell, direction)) {
+      s_conflicts++;
+    }
+    if (present && vote < 3) {
+      vote++;
+    } else if (!present && vote > 0) {
+      vote--;
+    }
+  }
+  set_vote(cell, direction, vote);
+  bool wall = vote >= 2;
+  if (wall == is_wall(cell, direction)) {
+    return;
+  }
+  if (wall) {
+    set_wall_present(cell, direction);
+  } else {
+    set_wall_absent(cell, direction);
+  }
+  if (known) {
+    s_repairs++;
+  }
+}
+
+static bool goal_is_closed() {
+  for (uint8_t i = 0; i < maze_goal_count(); i++) {
+    cell_t cell = maze_goal_cell(i);
+    for (uint8_t direction = 0; direction < 4; direction++) {
+      if (is_exit(cell, direction) && !is_goal(neighbour(cell, direction))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/***
+ * Check one cell. Walls set from only one side are repaired using the
+ * counts and missing outside walls are put back. A cell with four walls
+ * or a closed goal area can only be reported because there is no way to
+ * tell which wall is wrong.
+ *
+ * Only the cell and its neighbours are looked at so the search calls this
+ * for each cell as it is mapped. Returns the problems found.
+ */
+uint8_t maze_check_cell(cell_t cell) {
+  uint8_t problems = 0;
+  for (uint8_t direction = 0; direction < 4; direction++) {
+    if (on_boundary(cell, direction)) {
+      if (is_exit(cell, direction)) {
+        problems |= MAP_NO_BOUNDARY;
+        set_wall_present(cell, direction);
+      }
+      continue;
+    }
+    cell_t next = neighbour(cell, direction);
+    if (is_wall(cell, direction) != is_wall(next, (direction + 2) & 0x03)) {
+      problems |= MAP_ONE_SIDED;
+      if (get_vote(cell, direction) >= 2) {
+        set_wall_present(cell, direction);
+      } else {
+        set_wall_absent(cell, direction);
+      }
+    }
+  }
+  if ((walls[cell] & 0x0F) == 0x0F) {
+    problems |= MAP_ISOLATED;
+  }
+  if (is_goal(cell) && goal_is_closed()) {
+    problems |= MAP_GOAL_CLOSED;
+  }
+  s_problems |= problems;
+  return problems;
+}
+
+/***
+ * Check every cell and then flood the maze to see if the goal can be
+ * reached from the start. Unknown walls are taken to be absent so a
+ * map without a route is definitely wrong. The cost array is changed.
+ */
+uint8_t maze_check_all() {
+  uint8_t problems = 0;
+  for (int cell = 0; cell < MAZE_CELLS; cell++) {
+    problems |= maze_check_cell(cell);
+  }
+  flood_maze(maze_goal());
+  if (cost[START] == MAX_COST) {
+    problems |= MAP_NO_ROUTE;
+  }
+  s_problems |= problems;
+  return problems;
+}
+
+// all the problems found since maze_check_begin()
+uint8_t maze_check_problems() {
+  return s_problems;
+}
+
+int maze_check_conflicts() {
+  return s_conflicts;
+}
+
+int maze_check_repairs() {
+  return s_repairs;
+}
@@ -0,0 +1,56 @@
+/*
+ * File: maze_check.h
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+
+#ifndef MAZE_CHECK_H
+#define MAZE_CHECK_H
+
+#include "maze.h"
+#include <stdint.h>
+
+/***
+ * The map can go wrong in two ways. A sensor can misread a wall, and the
+ * walls array survives a reset so it can hold rubbish after a crash. The
+ * checker looks for maps that cannot be right:
+ */
+enum {
+  MAP_ONE_SIDED = 0x01,   // a wall is set from only one side
+  MAP_NO_BOUNDARY = 0x02, // an outside wall is missing
+  MAP_ISOLATED = 0x04,    // a cell has four walls
+  MAP_GOAL_CLOSED = 0x08, // there is no way into the goal area
+  MAP_NO_ROUTE = 0x10,    // the goal cannot be reached from the start
+};
+
+void maze_check_begin();
+void maze_check_observe(cell_t cell, uint8_t direction, bool present);
+uint8_t maze_check_cell(cell_t cell);
+uint8_t maze_check_all();
+uint8_t maze_check_problems();
+int maze_check_conflicts();
+int maze_check_repairs();
+
+#endif // MAZE_CHECK_H
@@ -0,0 +1,133 @@
+/*
+ * File: maze_store.cpp
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "maze_store.h"
+#include "EEPROM.h"
+#include "maze.h"
+#include "settings.h"
+#include <Arduino.h>
+#include <util/crc16.h>
+
+const uint16_t MAZE_STORE_MARKER = 0x4D5A; // 'MZ'
+
+struct MazeStoreHeader {
+  uint16_t marker;
+  uint16_t cells;
+  uint16_t crc;
+};
+
+const int MAZE_DATA_ADDRESS = MAZE_EEPROM_ADDRESS + sizeof(MazeStoreHeader);
+
+static_assert(SETTINGS_EEPROM_ADDRESS + sizeof(Settings) <= MAZE_EEPROM_ADDRESS, "settings overlap the stored maze");
+#ifdef E2END
+static_assert(MAZE_DATA_ADDRESS + MAZE_CELLS <= E2END + 1, "the stored maze does not fit in EEPROM");
+#endif
+
+static uint16_t walls_crc() {
+  uint16_t crc = 0xFFFF;
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    crc = _crc16_update(crc, walls[i]);
+  }
+  return crc;
+}
+
+static uint16_t stored_crc() {
+  uint16_t crc = 0xFFFF;
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    crc = _crc16_update(crc, EEPROM.read(MAZE_DATA_ADDRESS + i));
+  }
+  return crc;
+}
+
+/***
+ * Copy the walls into EEPROM. Each EEPROM write takes about 3.3ms and
+ * the cells can only be written a limited number of times so only the
+ * bytes that have changed since the last save are written. After a
+ * search leg, that is typically a few tens of bytes.
+ *
+ * The header is invalidated before the data changes and only written
+ * back once all the data is in place. A save that is interrupted by a
+ * power failure leaves no valid copy rather than a corrupt one.
+ *
+ * Returns the number of bytes written
+ */
+int save_maze_to_eeprom() {
+  int written = 0;
+  MazeStoreHeader header;
+  EEPROM.get(MAZE_EEPROM_ADDRESS, header);
+  header.marker = 0;
+  EEPROM.put(MAZE_EEPROM_ADDRESS, header);
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    if (EEPROM.read(MAZE_DATA_ADDRESS + i) != walls[i]) {
+      EEPROM.write(MAZE_DATA_ADDRESS + i, walls[i]);
+      written++;
+    }
+  }
+  header.marker = MAZE_STORE_MARKER;
+  header.cells = MAZE_CELLS;
+  header.crc = walls_crc();
+  EEPROM.put(MAZE_EEPROM_ADDRESS, header);
+  return written;
+}
+
+bool stored_maze_is_valid() {
+  MazeStoreHeader header;
+  EEPROM.get(MAZE_EEPROM_ADDRESS, header);
+  if (header.marker != MAZE_STORE_MARKER || header.cells != MAZE_CELLS) {
+    return false;
+  }
+  return header.crc == stored_crc();
+}
+
+/***
+ * Replace the walls in RAM with the copy from EEPROM. The walls are
+ * left untouched if there is no valid copy.
+ *
+ * Returns true if the maze was loaded
+ */
+bool load_maze_from_eeprom() {
+  if (!stored_maze_is_valid()) {
+    return false;
+  }
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    walls[i] = EEPROM.read(MAZE_DATA_ADDRESS + i);
+  }
+  invalidate_flood();
+  clear_pruned_cells();
+  return true;
+}
+
+/***
+ * Only the marker is cleared. That is enough to stop the copy being
+ * loaded and saves wearing out the whole block.
+ */
+void erase_stored_maze() {
+  MazeStoreHeader header;
+  EEPROM.get(MAZE_EEPROM_ADDRESS, header);
+  header.marker = 0;
+  EEPROM.put(MAZE_EEPROM_ADDRESS, header);
+}
@@ -0,0 +1,51 @@
+/*
+ * File: maze_store.h
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#ifndef MAZE_STORE_H
+#define MAZE_STORE_H
+
+#include <stdint.h>
+
+/***
+ * A copy of the maze walls, including the visited flags, can be kept in
+ * EEPROM so that a search survives a power cycle or a brown-out.
+ *
+ * The copy sits after the settings block. The settings structure must
+ * never grow past MAZE_EEPROM_ADDRESS. That is checked at build time.
+ *
+ * The stored copy has a short header with a marker, the number of cells
+ * and a CRC of the wall data. A copy that fails any of those checks is
+ * never loaded.
+ */
+const int MAZE_EEPROM_ADDRESS = 0x0100;
+
+int save_maze_to_eeprom();
+bool load_maze_from_eeprom();
+bool stored_maze_is_valid();
+void erase_stored_maze();
+
+#endif // MAZE_STORE_H
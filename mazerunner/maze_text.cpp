@@ -0,0 +1,133 @@
+/*
+ * File: maze_text.cpp
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "maze_text.h"
+#include "maze.h"
+#include <Arduino.h>
+
+/***
+ * A maze drawing has MAZE_WIDTH + 1 lines of posts and horizontal walls
+ * with a line of cells and vertical walls between each pair. The top
+ * line holds the north walls of the top row.
+ */
+static uint8_t s_post_lines;     // lines of posts seen so far
+static uint8_t s_column;         // character position in the current line
+static bool s_cell_line;         // the current line holds cells
+static bool s_line_started;      // the type of the current line is known
+static bool s_skip_line;         // the current line is not part of the maze
+static bool s_complete;          // the bottom line of posts has ended
+
+/***
+ * Clear the map and get ready to read a new maze. The walls are all
+ * removed so the drawing needs to include the boundary.
+ */
+void maze_text_begin() {
+  invalidate_flood();
+  clear_pruned_cells();
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    cost[i] = 0;
+    walls[i] = 0;
+  }
+  s_post_lines = 0;
+  s_column = 0;
+  s_line_started = false;
+  s_skip_line = false;
+  s_complete = false;
+}
+
+bool maze_text_complete() {
+  return s_complete;
+}
+
+static void start_line(char c) {
+  s_line_started = true;
+  if (c == 'o' || c == '+') {
+    s_cell_line = false;
+    s_post_lines++;
+  } else if ((c == '|' || c == ' ') && s_post_lines > 0 && s_post_lines <= MAZE_WIDTH) {
+    s_cell_line = true;
+  } else {
+    s_skip_line = true;
+  }
+}
+
+/***
+ * Every fourth character is a post or a vertical wall. Horizontal walls
+ * are read from the middle of the three characters between posts.
+ */
+static void add_wall(char c) {
+  uint8_t col = s_column / 4;
+  uint8_t offset = s_column % 4;
+  if (s_cell_line) {
+    if (offset != 0 || c != '|') {
+      return;
+    }
+    int row = MAZE_WIDTH - s_post_lines;
+    if (col < MAZE_WIDTH) {
+      set_wall_present(row + MAZE_WIDTH * col, WEST);
+    } else if (col == MAZE_WIDTH) {
+      set_wall_present(row + MAZE_WIDTH * (col - 1), EAST);
+    }
+    return;
+  }
+  if (offset != 2 || c != '-' || col >= MAZE_WIDTH) {
+    return;
+  }
+  if (s_post_lines <= MAZE_WIDTH) {
+    set_wall_present((MAZE_WIDTH - s_post_lines) + MAZE_WIDTH * col, NORTH);
+  } else {
+    set_wall_present(MAZE_WIDTH * col, SOUTH);
+  }
+}
+
+/***
+ * Feed the next character of the drawing to the reader.
+ *
+ * Returns true once the bottom line of posts has been read.
+ */
+bool maze_text_add(char c) {
+  if (c == '\n' || c == '\r') {
+    s_column = 0;
+    s_line_started = false;
+    s_skip_line = false;
+    if (s_post_lines > MAZE_WIDTH) {
+      s_complete = true;
+    }
+    return s_complete;
+  }
+  if (s_complete || s_skip_line) {
+    return s_complete;
+  }
+  if (!s_line_started) {
+    start_line(c);
+  }
+  if (!s_skip_line) {
+    add_wall(c);
+  }
+  s_column++;
+  return false;
+}
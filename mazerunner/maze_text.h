@@ -0,0 +1,53 @@
+/*
+ * File: maze_text.h
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#ifndef MAZE_TEXT_H
+#define MAZE_TEXT_H
+
+#include <stdint.h>
+
+/***
+ * Mazes are commonly shared as plain text in the same style that
+ * print_maze_plain() uses:
+ *
+ *   o---o---o---o
+ *   |           |
+ *   o   o---o   o
+ *   |   |       |
+ *   o---o---o---o
+ *
+ * The text is read one character at a time so that a maze can be pasted
+ * into the serial terminal without a buffer for a whole line. Posts may
+ * be 'o' or '+'. Anything in the middle of a cell, such as a cost or a
+ * direction, is ignored, as are lines that do not start with a post or
+ * a wall. Only the walls are read. No cell is marked as visited.
+ */
+void maze_text_begin();
+bool maze_text_add(char c);
+bool maze_text_complete();
+
+#endif // MAZE_TEXT_H
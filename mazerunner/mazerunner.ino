@@ -32,6 +32,8 @@
 
 #include "encoders.h"
 #include "maze.h"
+#include "maze_check.h"
+#include "maze_store.h"
 #include "motors.h"
 #include "reports.h"
 #include "sensors.h"
@@ -64,8 +66,14 @@ void setup() {
   disable_sensors();
   if (button_pressed()) {
     initialise_maze(emptyMaze);
+    erase_stored_maze();
     Serial.println(F("Clearing the Maze"));
     wait_for_button_release();
+  } else if (load_maze_from_eeprom()) {
+    Serial.println(F("Maze restored"));
+    if (maze_check_all()) {
+      Serial.println(F("Maze map has problems - C to check"));
+    }
   }
   Serial.println(F("RDY"));
 }
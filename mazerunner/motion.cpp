@@ -33,6 +33,7 @@
 #include "motion.h"
 #include "motors.h"
 #include "profile.h"
+#include "queue.h"
 #include "reports.h"
 #include "sensors.h"
 #include <Arduino.h>
@@ -58,7 +59,9 @@ void reset_drive_system() {
   disable_steering();
   reset_encoders();
   reset_motor_controllers();
+  clear_motion_queue();
   forward.reset();
+  forward.set_jerk(FORWARD_JERK);
   rotation.reset();
 }
 
@@ -125,7 +128,7 @@ void spin_turn(float degrees, float speed, float acceleration) {
  * distance. Clearly, there must be enough distance remaining for it to
  * brake to a halt.
  *
- * The current values for speed and acceleration are used.
+ * The current values for speed, acceleration and deceleration are used.
  *
  * Calling this with the robot stationary is undefined. Don't do that.
  *
@@ -133,7 +136,7 @@ void spin_turn(float degrees, float speed, float acceleration) {
  */
 void stop_at(float position) {
   float remaining = position - forward.position();
-  forward.start(remaining, forward.speed(), 0, forward.acceleration());
+  forward.start(remaining, forward.speed(), 0, forward.acceleration(), forward.deceleration());
   while (not forward.is_finished()) {
     report_profile();
   }
@@ -146,19 +149,169 @@ void stop_at(float position) {
  * Clearly, there must be enough distance remaining for it to
  * brake to a halt.
  *
- * The current values for speed and acceleration are used.
+ * The current values for speed, acceleration and deceleration are used.
  *
  * Calling this with the robot stationary is undefined. Don't do that.
  *
  * @brief bring the robot to a halt after a specific distance
  */
 void stop_after(float distance) {
-  forward.start(distance, forward.speed(), 0, forward.acceleration());
+  forward.start(distance, forward.speed(), 0, forward.acceleration(), forward.deceleration());
   while (not forward.is_finished()) {
     report_profile();
   }
 }
 
+//***************************************************************************//
+/***
+ * Each queued segment drives one profile. A combined segment is queued as
+ * two of these with SEG_WITH_NEXT set on the first so that the ISR starts
+ * them in the same tick. The speeds and accelerations are kept as whole
+ * numbers to keep the queue small. Accelerations are unsigned so that the
+ * fast turns can use up to 65535. A played back segment keeps the ramp
+ * length, in ticks, where the acceleration would be.
+ */
+enum : uint8_t {
+  SEG_FORWARD = 0x01,
+  SEG_ROTATION = 0x02,
+  SEG_PLAYBACK = 0x04,
+  SEG_WITH_NEXT = 0x80,
+};
+
+struct segment_t {
+  uint8_t flags;
+  float distance;
+  int16_t top_speed;
+  int16_t final_speed;
+  uint16_t acceleration;
+  uint16_t deceleration;
+};
+
+static Queue<segment_t, MOTION_QUEUE_LENGTH> s_motion_queue;
+// the profiles started by the segment that is running now
+static volatile uint8_t s_running_profiles = 0;
+
+static void wait_for_space(int count) {
+  while (motion_queue_size() > MOTION_QUEUE_LENGTH - count) {
+    delay(2);
+  }
+}
+
+void queue_forward(float distance, float top_speed, float final_speed, float acceleration, float deceleration) {
+  segment_t segment = {SEG_FORWARD, distance, (int16_t)top_speed, (int16_t)final_speed, (uint16_t)acceleration, (uint16_t)deceleration};
+  wait_for_space(1);
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    s_motion_queue.add(segment);
+  }
+}
+
+void queue_rotation(float angle, float omega, float final_omega, float alpha) {
+  segment_t segment = {SEG_ROTATION, angle, (int16_t)omega, (int16_t)final_omega, (uint16_t)alpha, 0};
+  wait_for_space(1);
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    s_motion_queue.add(segment);
+  }
+}
+
+void queue_playback(float angle, float omega, uint16_t ramp_ticks) {
+  segment_t segment = {SEG_ROTATION | SEG_PLAYBACK, angle, (int16_t)omega, 0, ramp_ticks, 0};
+  wait_for_space(1);
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    s_motion_queue.add(segment);
+  }
+}
+
+/***
+ * Both halves go in together so that the ISR can never find the first
+ * without the second.
+ */
+void queue_combined(float distance, float top_speed, float final_speed, float acceleration, float angle, float omega, float alpha) {
+  segment_t move = {SEG_FORWARD | SEG_WITH_NEXT, distance, (int16_t)top_speed, (int16_t)final_speed, (uint16_t)acceleration, 0};
+  segment_t turn = {SEG_ROTATION, angle, (int16_t)omega, 0, (uint16_t)alpha, 0};
+  wait_for_space(2);
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    s_motion_queue.add(move);
+    s_motion_queue.add(turn);
+  }
+}
+
+uint8_t motion_queue_size() {
+  uint8_t size;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    size = s_motion_queue.size();
+  }
+  return size;
+}
+
+/***
+ * True once the queue is empty and the last segment has finished. The
+ * robot may well still be moving at the final speed of that segment.
+ */
+bool motion_queue_done() {
+  bool done;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    done = s_motion_queue.size() == 0;
+    if ((s_running_profiles & SEG_FORWARD) && not forward.is_finished()) {
+      done = false;
+    }
+    if ((s_running_profiles & SEG_ROTATION) && not rotation.is_finished()) {
+      done = false;
+    }
+  }
+  return done;
+}
+
+void wait_for_motion_queue() {
+  while (not motion_queue_done()) {
+    delay(2);
+  }
+}
+
+/***
+ * Throws away any queued segments. The profiles are left as they are so
+ * the robot carries on with whatever it is doing now.
+ */
+void clear_motion_queue() {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    s_motion_queue.clear();
+    s_running_profiles = 0;
+  }
+}
+
+/***
+ * Called by the systick ISR straight after the profiles are updated. When
+ * everything started by the current segment has finished, the next one is
+ * started at once. Profile::start() leaves the speed alone so the robot
+ * goes on at the final speed of the last segment. Most ticks only check
+ * the queue size.
+ */
+void update_motion_queue() {
+  if (s_motion_queue.size() == 0) {
+    return;
+  }
+  if ((s_running_profiles & SEG_FORWARD) && not forward.is_finished()) {
+    return;
+  }
+  if ((s_running_profiles & SEG_ROTATION) && not rotation.is_finished()) {
+    return;
+  }
+  s_running_profiles = 0;
+  uint8_t flags;
+  do {
+    segment_t segment = s_motion_queue.head();
+    Profile &profile = (segment.flags & SEG_ROTATION) ? rotation : forward;
+    if (segment.flags & SEG_PLAYBACK) {
+      profile.start_playback(segment.distance, segment.top_speed, segment.acceleration);
+    } else {
+      profile.start(segment.distance, segment.top_speed, segment.final_speed, segment.acceleration, segment.deceleration);
+    }
+    s_running_profiles |= segment.flags & (SEG_FORWARD | SEG_ROTATION);
+    flags = segment.flags;
+  } while ((flags & SEG_WITH_NEXT) && s_motion_queue.size() > 0);
+}
+
+//***************************************************************************//
+
 /**
  * The robot is assumed to be moving. This utility function call will just
  * do a busy-wait until the forward profile gets to the supplied position.
@@ -210,6 +363,9 @@ void wait_until_distance(float distance) {
  *
  * http://www.micromouseonline.com/2015/06/29/minos-2015-presentations/
  *
+ * The turns in turns.cpp do that. Each is described by its shape and the
+ * omega and alpha are worked out from the forward speed.
+ *
  *
  * You can normally expect the turn to be symmetrical.
  *
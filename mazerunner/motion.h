@@ -49,4 +49,33 @@ void turn_SS90R_example();
 void turn_around();
 void spin_turn(float degrees, float speed, float acceleration);
 
+/***
+ * Moves can be queued ahead of time. The systick ISR starts the next
+ * segment in the same tick that the current one finishes, so there is no
+ * gap and the speed carries straight on into the next segment. A combined
+ * segment starts the forward and rotation profiles together and is done
+ * when both have finished.
+ *
+ * A played back rotation follows the ramp table rather than a trapezoid.
+ * It comes to rest at the end. See Profile::start_playback().
+ *
+ * Queueing blocks while the queue is full. Do not start the profiles
+ * directly while queued segments are still running.
+ *
+ * Since queueing waits for room, a longer queue only lets the caller get
+ * further ahead. The most that has to be queued in one go is the three
+ * segments of a search turn. Each segment is 13 bytes so four is enough.
+ */
+#define MOTION_QUEUE_LENGTH 4
+
+void queue_forward(float distance, float top_speed, float final_speed, float acceleration, float deceleration = 0);
+void queue_rotation(float angle, float omega, float final_omega, float alpha);
+void queue_playback(float angle, float omega, uint16_t ramp_ticks);
+void queue_combined(float distance, float top_speed, float final_speed, float acceleration, float angle, float omega, float alpha);
+uint8_t motion_queue_size();
+bool motion_queue_done();
+void wait_for_motion_queue();
+void clear_motion_queue();
+void update_motion_queue();
+
 #endif
@@ -43,10 +43,26 @@ float g_left_motor_volts;
 float g_right_motor_volts;
 
 static bool s_controllers_output_enabled;
+#if FIXED_POINT_CONTROL
+static fixed_t s_old_fwd_error;
+static fixed_t s_old_rot_error;
+static fixed_t s_fwd_error;
+static fixed_t s_rot_error;
+// Q8.8 copies of the controller gains, taken when the controllers are reset
+static int16_t s_fwd_kp;
+static int16_t s_fwd_kd;
+static int16_t s_rot_kp;
+static int16_t s_rot_kd;
+// volts for a speed of one unit per tick, as Q.12
+const int32_t FWD_SPEED_FF = (int32_t)(SPEED_FF * LOOP_FREQUENCY * 4096 + 0.5);
+const int32_t ROT_SPEED_FF = (int32_t)((PI / 180.0) * MOUSE_RADIUS * SPEED_FF * LOOP_FREQUENCY * 4096 + 0.5);
+const fixed_t MAX_MOTOR_VOLTS_FIXED = (fixed_t)(MAX_MOTOR_VOLTS * FIXED_ONE);
+#else
 static float s_old_fwd_error;
 static float s_old_rot_error;
 static float s_fwd_error;
 static float s_rot_error;
+#endif
 Profile forward;
 Profile rotation;
 
@@ -58,11 +74,23 @@ void disable_motor_controllers() {
   s_controllers_output_enabled = false;
 }
 
+#if FIXED_POINT_CONTROL
+static int16_t to_gain(float gain) {
+  return (int16_t)(constrain(gain, -127.0f, 127.0f) * 256 + 0.5f);
+}
+#endif
+
 void reset_motor_controllers() {
   s_fwd_error = 0;
   s_rot_error = 0;
   s_old_fwd_error = 0;
   s_old_rot_error = 0;
+#if FIXED_POINT_CONTROL
+  s_fwd_kp = to_gain(settings.fwdKP);
+  s_fwd_kd = to_gain(settings.fwdKD);
+  s_rot_kp = to_gain(settings.rotKP);
+  s_rot_kd = to_gain(settings.rotKD);
+#endif
 }
 
 void setup_motors() {
@@ -78,6 +106,53 @@ void setup_motors() {
   stop_motors();
 }
 
+#if FIXED_POINT_CONTROL
+/***
+ * Errors are cut down to Q.8 and limited to +/- 64 units so that the
+ * products cannot overflow. An error that big has the motors flat out
+ * anyway.
+ */
+static fixed_t controller_output(int16_t kp, fixed_t error, int16_t kd, fixed_t diff) {
+  int32_t p = constrain(error >> 8, -16383, 16383);
+  int32_t d = constrain(diff >> 8, -16383, 16383);
+  return kp * p + kd * d;
+}
+
+fixed_t position_controller() {
+  s_fwd_error += forward.fixed_increment() - robot_fwd_increment_fixed();
+  fixed_t diff = s_fwd_error - s_old_fwd_error;
+  s_old_fwd_error = s_fwd_error;
+  return controller_output(s_fwd_kp, s_fwd_error, s_fwd_kd, diff);
+}
+
+fixed_t angle_controller(float steering_adjustment) {
+  s_rot_error += rotation.fixed_increment() - robot_rot_increment_fixed();
+  if (g_steering_enabled) {
+    s_rot_error += to_fixed(steering_adjustment);
+  }
+  fixed_t diff = s_rot_error - s_old_rot_error;
+  s_old_rot_error = s_rot_error;
+  return controller_output(s_rot_kp, s_rot_error, s_rot_kd, diff);
+}
+
+static void set_left_motor_volts_fixed(fixed_t volts);
+static void set_right_motor_volts_fixed(fixed_t volts);
+
+void update_motor_controllers(float steering_adjustment) {
+  fixed_t pos_output = position_controller();
+  fixed_t rot_output = angle_controller(steering_adjustment);
+  fixed_t left_output = pos_output - rot_output;
+  fixed_t right_output = pos_output + rot_output;
+  fixed_t fwd_ff = ((forward.tick_speed() >> 12) * FWD_SPEED_FF) >> 8;
+  fixed_t rot_ff = ((rotation.tick_speed() >> 12) * ROT_SPEED_FF) >> 8;
+  left_output += fwd_ff - rot_ff;
+  right_output += fwd_ff + rot_ff;
+  if (s_controllers_output_enabled) {
+    set_right_motor_volts_fixed(right_output);
+    set_left_motor_volts_fixed(left_output);
+  }
+}
+#else
 float position_controller() {
   s_fwd_error += forward.increment() - robot_fwd_increment();
   float diff = s_fwd_error - s_old_fwd_error;
@@ -117,6 +192,7 @@ void update_motor_controllers(float steering_adjustment) {
     set_left_motor_volts(left_output);
   }
 }
+#endif
 /**
  * Direct register access could be used here for enhanced performance
  */
@@ -142,6 +218,30 @@ void set_right_motor_pwm(int pwm) {
   }
 }
 
+#if FIXED_POINT_CONTROL
+// volts as Q.8 times the Q8.8 battery scale gives the PWM as Q.16
+static void set_left_motor_volts_fixed(fixed_t volts) {
+  volts = constrain(volts, -MAX_MOTOR_VOLTS_FIXED, MAX_MOTOR_VOLTS_FIXED);
+  g_left_motor_volts = from_fixed(volts);
+  int motorPWM = (int)(((volts >> 8) * g_battery_scale_fixed) / 65536L);
+  set_left_motor_pwm(motorPWM);
+}
+
+static void set_right_motor_volts_fixed(fixed_t volts) {
+  volts = constrain(volts, -MAX_MOTOR_VOLTS_FIXED, MAX_MOTOR_VOLTS_FIXED);
+  g_right_motor_volts = from_fixed(volts);
+  int motorPWM = (int)(((volts >> 8) * g_battery_scale_fixed) / 65536L);
+  set_right_motor_pwm(motorPWM);
+}
+
+void set_left_motor_volts(float volts) {
+  set_left_motor_volts_fixed(to_fixed(constrain(volts, -MAX_MOTOR_VOLTS, MAX_MOTOR_VOLTS)));
+}
+
+void set_right_motor_volts(float volts) {
+  set_right_motor_volts_fixed(to_fixed(constrain(volts, -MAX_MOTOR_VOLTS, MAX_MOTOR_VOLTS)));
+}
+#else
 void set_left_motor_volts(float volts) {
   volts = constrain(volts, -MAX_MOTOR_VOLTS, MAX_MOTOR_VOLTS);
   g_left_motor_volts = volts;
@@ -155,6 +255,7 @@ void set_right_motor_volts(float volts) {
   int motorPWM = (int)(volts * g_battery_scale);
   set_right_motor_pwm(motorPWM);
 }
+#endif
 
 void set_motor_pwm_frequency(int frequency) {
   switch (frequency) {
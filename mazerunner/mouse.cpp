@@ -32,19 +32,89 @@
 
 #include "mouse.h"
 #include "Arduino.h"
+#include "dstar.h"
 #include "encoders.h"
 #include "maze.h"
+#include "maze_check.h"
+#include "maze_store.h"
 #include "motion.h"
 #include "motors.h"
 #include "profile.h"
 #include "reports.h"
 #include "sensors.h"
+#include "turns.h"
 #include "ui.h"
 
 Mouse dorothy;
 
-char path[128];
-char commands[128];
+move_t moves[MOVE_LIST_LENGTH];
+
+// where make_path() finished and which way the mouse will be facing
+static cell_t s_path_end;
+static unsigned char s_path_end_heading;
+
+/***
+ * During a search, the decision for the next cell is worked out while the
+ * mouse is still travelling through the current one. search_to() asks
+ * for a plan as soon as it knows which cell comes next. The plan is made
+ * by plan_ahead(), which is called from the moves at a point where the
+ * mouse has time to spare, such as during the rotation of a turn. At the
+ * sensing point, the decision is then just a table lookup.
+ *
+ * If, for any reason, there is no plan for the cell, search_to() floods
+ * and decides in the usual way.
+ */
+static bool s_plan_wanted = false;
+static bool s_plan_ready = false;
+static cell_t s_plan_target;
+static cell_t s_plan_cell;
+static unsigned char s_plan_heading;
+static unsigned char s_plan[8];
+
+/***
+ * While explore_until_solved() is running, the target is not fixed. Every
+ * time a plan is made, the nearest useful cell is chosen again from the
+ * cell ahead. The mouse turns towards a better cell as soon as the walls
+ * it finds make one nearer, and carries straight on to the next one when
+ * it reaches its target. Once the maze is solved, or no useful cell is
+ * left, the cell ahead becomes the target and the search stops there.
+ */
+static bool s_exploring = false;
+static cell_t s_explore_target;
+
+static void request_plan(cell_t target, cell_t cell, unsigned char heading) {
+  s_plan_target = target;
+  s_plan_cell = cell;
+  s_plan_heading = heading;
+  s_plan_ready = false;
+  s_plan_wanted = true;
+}
+
+static void cancel_plan() {
+  s_plan_wanted = false;
+  s_plan_ready = false;
+}
+
+static void plan_ahead() {
+  if (!s_plan_wanted || s_plan_ready) {
+    return;
+  }
+  if (s_exploring) {
+    if (maze_is_solved() || !nearest_frontier_cell(s_plan_cell, &s_explore_target)) {
+      s_explore_target = s_plan_cell;
+    }
+    s_plan_target = s_explore_target;
+    if (is_target(s_plan_cell, s_plan_target)) {
+      s_plan_wanted = false;
+      return;
+    }
+  }
+#if SEARCH_PRUNING
+  prune_maze(s_plan_target, s_plan_cell);
+#endif
+  plan_decisions(s_plan_target, s_plan_cell, s_plan_heading, s_plan);
+  s_plan_ready = true;
+}
 char p_mouse_state __attribute__((section(".noinit")));
 
 static char dirLetters[] = "NESW";
@@ -80,7 +150,7 @@ void print_walls() {
 static void stopAndAdjust() {
   float remaining = (FULL_CELL + HALF_CELL) - forward.position();
   disable_steering();
-  forward.start(remaining, forward.speed(), 0, forward.acceleration());
+  forward.start(remaining, forward.speed(), 0, forward.acceleration(), forward.deceleration());
   while (not forward.is_finished()) {
     if (g_front_wall_sensor > (FRONT_REFERENCE - 150)) {
       break;
@@ -113,16 +183,21 @@ void turn_IP90L() {
   spin_turn(90, SPEEDMAX_SPIN_TURN, SPIN_TURN_ACCELERATION);
 }
 
-void turnSS90L() {
-  turn(90, 200, 2000);
+/**
+ * These queue their move so they return at once unless the queue is full.
+ * Use wait_for_motion_queue() to wait for the robot to catch up.
+ */
+
+void queue_IP90R() {
+  queue_rotation(-90, SPEEDMAX_SPIN_TURN, 0, SPIN_TURN_ACCELERATION);
 }
 
-void turnSS90R() {
-  turn(-90, 200, 2000);
+void queue_IP90L() {
+  queue_rotation(90, SPEEDMAX_SPIN_TURN, 0, SPIN_TURN_ACCELERATION);
 }
 
 void move_forward(float distance, float top_speed, float end_speed) {
-  forward.start(distance, top_speed, end_speed, SEARCH_ACCELERATION);
+  queue_forward(distance, top_speed, end_speed, SEARCH_ACCELERATION, SEARCH_DECELERATION);
 }
 
 //***************************************************************************//
@@ -132,7 +207,7 @@ void Mouse::end_run() {
   disable_steering();
   log_status('T');
   float remaining = (FULL_CELL + HALF_CELL) - forward.position();
-  forward.start(remaining, forward.speed(), 30, forward.acceleration());
+  forward.start(remaining, forward.speed(), 30, forward.acceleration(), forward.deceleration());
   if (has_wall) {
     while (get_front_sensor() < 850) {
       delay(2);
@@ -164,70 +239,66 @@ void Mouse::end_run() {
  * TODO: There is only just enough space to get down to turn speed. Increase turn speed to 350?
  *
  */
-void Mouse::turn_SS90ER() {
+/***
+ * The search turns were tuned on the robot at 300mm/s. The right turn
+ * started its rotation 25mm past the cell boundary and the left turn 17mm
+ * past it. Both ran out 10mm to the sensing point. The SS90 shape puts the
+ * rotation 17.8mm past the boundary on either side, so these trims put
+ * the tuned offsets back on top of it.
+ */
+const float SS90ER_RUN_IN_TRIM = 7.2;  // mm
+const float SS90EL_RUN_IN_TRIM = -0.8; // mm
+const float SS90E_RUN_OUT_TRIM = 2.2;  // mm
 
-  float run_in = 15.0;  // mm
-  float run_out = 10.0; // mm
-  float angle = -90.0;  // deg
-  float omega = 280;    // deg/s
-  float alpha = 4000;   // deg/s/s
+/***
+ * Queue the whole search turn. The rotation starts where the SS90 shape
+ * says it should, plus the trim for that side, measured from the cell
+ * boundary at FULL_CELL. If the front sensor sees the wall ahead first,
+ * the run in is cut short there and this returns true.
+ */
+static bool queue_search_turn(move_t turn) {
+  TurnShape shape;
+  get_turn_shape(turn, shape);
+  float speed = DEFAULT_TURN_SPEED;
+  float run_in = shape.run_in + (turn == MOVE_RIGHT ? SS90ER_RUN_IN_TRIM : SS90EL_RUN_IN_TRIM);
+  float run_out = shape.run_out - 10.0 + SS90E_RUN_OUT_TRIM;
+  float distance = FULL_CELL + run_in - forward.position();
+  queue_forward(distance, forward.speed(), speed, SEARCH_ACCELERATION, SEARCH_DECELERATION);
+  queue_turn_rotation(turn, shape, speed);
+  queue_forward(run_out, speed, DEFAULT_SEARCH_SPEED, SEARCH_ACCELERATION, SEARCH_DECELERATION);
   bool triggered = false;
-  disable_steering();
-  float distance = FULL_CELL + 10.0 + run_in - forward.position();
-  forward.start(distance, forward.speed(), DEFAULT_TURN_SPEED, SEARCH_ACCELERATION);
-  while (not forward.is_finished()) {
+  // the run in is going while the other two are still queued
+  while (motion_queue_size() > 1) {
     delay(2);
-    if (g_front_wall_sensor > 54) {
+    if (g_front_wall_sensor > 54 && motion_queue_size() == 2) {
       forward.set_state(CS_FINISHED);
       triggered = true;
     }
   }
-  if (triggered) {
+  return triggered;
+}
+
+void Mouse::turn_SS90ER() {
+  disable_steering();
+  if (queue_search_turn(MOVE_RIGHT)) {
     log_status('R');
   } else {
     log_status('r');
   }
-  rotation.start(angle, omega, 0, alpha);
-  while (not rotation.is_finished()) {
-    delay(2);
-  }
-  forward.start(run_out, forward.speed(), DEFAULT_SEARCH_SPEED, SEARCH_ACCELERATION);
-  while (not forward.is_finished()) {
-    delay(2);
-  }
+  plan_ahead();
+  wait_for_motion_queue();
   forward.set_position(FULL_CELL - 10.0);
 }
 
 void Mouse::turn_SS90EL() {
-  float run_in = 7.0;   // mm
-  float run_out = 10.0; // mm
-  float angle = 90.0;   // deg
-  float omega = 280;    // deg/s
-  float alpha = 4000;   // deg/s/s
-  bool triggered = false;
   disable_steering();
-  float distance = FULL_CELL + 10.0 + run_in - forward.position();
-  forward.start(distance, forward.speed(), DEFAULT_TURN_SPEED, SEARCH_ACCELERATION);
-  while (not forward.is_finished()) {
-    delay(2);
-    if (g_front_wall_sensor > 54) {
-      forward.set_state(CS_FINISHED);
-      triggered = true;
-    }
-  }
-  if (triggered) {
+  if (queue_search_turn(MOVE_LEFT)) {
     log_status('L');
   } else {
     log_status('l');
   }
-  rotation.start(angle, omega, 0, alpha);
-  while (not rotation.is_finished()) {
-    delay(2);
-  }
-  forward.start(run_out, forward.speed(), DEFAULT_SEARCH_SPEED, SEARCH_ACCELERATION);
-  while (not forward.is_finished()) {
-    delay(2);
-  }
+  plan_ahead();
+  wait_for_motion_queue();
   forward.set_position(FULL_CELL - 10.0);
 }
 
@@ -248,7 +319,7 @@ void Mouse::turn_around() {
   disable_steering();
   log_status('A');
   float remaining = (FULL_CELL + HALF_CELL) - forward.position();
-  forward.start(remaining, forward.speed(), 30, forward.acceleration());
+  forward.start(remaining, forward.speed(), 30, forward.acceleration(), forward.deceleration());
   if (has_wall) {
     while (get_front_sensor() < FRONT_REFERENCE) {
       delay(2);
@@ -260,11 +331,10 @@ void Mouse::turn_around() {
   }
   // Be sure robot has come to a halt.
   forward.stop();
-  spin_turn(-180, SPEEDMAX_SPIN_TURN, SPIN_TURN_ACCELERATION);
-  forward.start(HALF_CELL - 10.0, SPEEDMAX_EXPLORE, SPEEDMAX_EXPLORE, SEARCH_ACCELERATION);
-  while (not forward.is_finished()) {
-    delay(2);
-  }
+  queue_rotation(-180, SPEEDMAX_SPIN_TURN, 0, SPIN_TURN_ACCELERATION);
+  queue_forward(HALF_CELL - 10.0, SPEEDMAX_EXPLORE, SPEEDMAX_EXPLORE, SEARCH_ACCELERATION, SEARCH_DECELERATION);
+  plan_ahead();
+  wait_for_motion_queue();
   forward.set_position(FULL_CELL - 10.0);
 }
 
@@ -307,7 +377,7 @@ void Mouse::log_status(char action) {
   Serial.print(' ');
 }
 
-void Mouse::follow_to(unsigned char target) {
+void Mouse::follow_to(cell_t target) {
   handStart = true;
   location = 0;
   heading = NORTH;
@@ -318,7 +388,7 @@ void Mouse::follow_to(unsigned char target) {
   enable_sensors();
   reset_drive_system();
   enable_motor_controllers();
-  forward.start(BACK_WALL_TO_CENTER, SPEEDMAX_EXPLORE, SPEEDMAX_EXPLORE, SEARCH_ACCELERATION);
+  forward.start(BACK_WALL_TO_CENTER, SPEEDMAX_EXPLORE, SPEEDMAX_EXPLORE, SEARCH_ACCELERATION, SEARCH_DECELERATION);
   while (not forward.is_finished()) {
     delay(2);
   }
@@ -326,7 +396,7 @@ void Mouse::follow_to(unsigned char target) {
   Serial.println(F("Off we go..."));
   wait_until_position(FULL_CELL - 10);
   // at the start of this loop we are always at the sensing point
-  while (location != target) {
+  while (!is_target(location, target)) {
     if (button_pressed()) {
       break;
     }
@@ -336,7 +406,7 @@ void Mouse::follow_to(unsigned char target) {
     location = neighbour(location, heading);
     update_sensors();
     update_map();
-    flood_maze(maze_goal());
+    update_flood(maze_goal());
     unsigned char newHeading = direction_to_smallest(location, heading);
     unsigned char hdgChange = (newHeading - heading) & 0x3;
     Serial.print(hdgChange);
@@ -344,7 +414,7 @@ void Mouse::follow_to(unsigned char target) {
     Serial.write('|');
     Serial.write(' ');
     log_status('.');
-    if (location == target) {
+    if (is_target(location, target)) {
       end_run();
     } else if (!leftWall) {
       turn_SS90EL();
@@ -401,6 +471,31 @@ void Mouse::report_status() {
   Serial.println();
 }
 
+/***
+ * When the route carries straight on through cells that have already been
+ * visited, there is nothing new to see and nothing to decide in them. This
+ * counts those cells, starting with the one after the given cell, so that
+ * the search can cross them in one faster move. The count stops before a
+ * cell that has not been visited, a cell where the route turns or a target
+ * cell. The mouse slows to search speed in time to decide there as usual.
+ *
+ * The costs are whatever the last decision used. That may be the flood
+ * that left out the cell the mouse is entering. Either way, every cell on
+ * the route ahead has a neighbour with a smaller cost.
+ */
+static uint8_t known_straight(cell_t cell, unsigned char heading, cell_t target) {
+  uint8_t cells = 0;
+  cell_t next = neighbour(cell, heading);
+  while (cells < MAZE_WIDTH && cell_is_visited(next) && !is_target(next, target)) {
+    if (cost[next] == MAX_COST || direction_to_smallest(next, heading) != heading) {
+      break;
+    }
+    cells++;
+    next = neighbour(next, heading);
+  }
+  return cells;
+}
+
 /***
  * The mouse is assumed to be centrally placed in a cell and may be
  * stationary. The current location is known and need not be any cell
@@ -410,21 +505,34 @@ void Mouse::report_status() {
  * the map.
  *
  * On execution, the mouse will search the maze until it reaches the
- * given target.
+ * given target. If the target is one of the goal cells, the search ends
+ * in whichever goal cell the mouse enters first.
  *
  * The maze is mapped as each cell is entered. Mapping happens even in
- * cells that have already been visited. Walls are only ever added, not
- * removed.
+ * cells that have already been visited, except those that the mouse
+ * passes straight through with SEARCH_STRAIGHTS. A wall is only removed
+ * when most sightings say that it is not there.
  *
  * It is possible for the mapping process to make the mouse think it
- * is walled in with no route to the target.
+ * is walled in with no route to the target. Walls that are seen again
+ * are voted on so a single misread can be put right when the mouse
+ * passes that way again.
+ *
+ * If the mouse is already at the target, it does not move at all.
  *
  * Returns  0  if the search is successful
  *         -1 if the maze has no route to the target.
  */
-int Mouse::search_to(unsigned char target) {
-
+int Mouse::search_to(cell_t target) {
+  if (is_target(location, target)) {
+    return 0;
+  }
+  maze_check_begin();
+#if DSTAR_PLANNER
+  dstar_begin(target, location);
+#else
   flood_maze(target);
+#endif
   // wait_for_front_sensor();
   delay(1000);
   enable_sensors();
@@ -436,15 +544,17 @@ int Mouse::search_to(unsigned char target) {
       delay(2);
     }
   }
-  forward.start(BACK_WALL_TO_CENTER, SPEEDMAX_EXPLORE, SPEEDMAX_EXPLORE, SEARCH_ACCELERATION);
+  forward.start(BACK_WALL_TO_CENTER, SPEEDMAX_EXPLORE, SPEEDMAX_EXPLORE, SEARCH_ACCELERATION, SEARCH_DECELERATION);
   while (not forward.is_finished()) {
     delay(2);
   }
   forward.set_position(HALF_CELL);
   Serial.println(F("Off we go..."));
+  cancel_plan();
   wait_until_position(FULL_CELL - 10);
+  int result = 0;
   // TODO. the robot needs to start each iteration at the sensing point
-  while (location != target) {
+  while (!is_target(location, target)) {
     if (button_pressed()) {
       break;
     }
@@ -452,28 +562,90 @@ int Mouse::search_to(unsigned char target) {
     log_status('-');
     enable_steering();
     location = neighbour(location, heading);
+    if (s_exploring) {
+      target = s_explore_target;
+    }
     update_sensors();
     update_map();
-    flood_maze(target);
-    unsigned char newHeading = direction_to_smallest(location, heading);
+    unsigned char newHeading;
+#if DSTAR_PLANNER
+    dstar_move_to(location);
+    newHeading = dstar_direction(heading);
+#else
+    if (s_plan_ready && s_plan_cell == location && s_plan_heading == heading) {
+      newHeading = s_plan[leftWall | (frontWall << 1) | (rightWall << 2)];
+    } else {
+#if SEARCH_PRUNING
+      prune_maze(target, location);
+#endif
+      update_flood(target);
+      newHeading = NO_ROUTE;
+      if (cost[location] != MAX_COST) {
+        newHeading = direction_to_smallest(location, heading);
+      }
+    }
+#endif
+    cancel_plan();
+    if (newHeading == NO_ROUTE) {
+      Serial.println(F("No route"));
+      result = -1;
+      end_run();
+      heading = (heading + 2) & 0x03;
+      break;
+    }
     unsigned char hdgChange = (newHeading - heading) & 0x3;
     Serial.print(hdgChange);
     Serial.write(' ');
     Serial.write('|');
     Serial.write(' ');
     log_status('.');
-    if (location == target) {
+    if (is_target(location, target)) {
       end_run();
       heading = (heading + 2) & 0x03;
     } else {
-
+#if !DSTAR_PLANNER
+      cell_t nextCell = neighbour(location, newHeading);
+      if (!is_target(nextCell, target) || s_exploring) {
+        request_plan(target, nextCell, newHeading);
+      }
+#endif
       switch (hdgChange) {
-        case 0: // ahead
-          forward.adjust_position(-FULL_CELL);
-          log_status('F');
-          wait_until_position(FULL_CELL - 10);
+        case 0: { // ahead
+          uint8_t cells = 0;
+#if SEARCH_STRAIGHTS && !DSTAR_PLANNER
+          cells = known_straight(location, heading, target);
+#endif
+          if (cells == 0) {
+            forward.adjust_position(-FULL_CELL);
+            log_status('F');
+            plan_ahead();
+            wait_until_position(FULL_CELL - 10);
+            log_status('x');
+            break;
+          }
+          // no decisions are needed until the sensing point of the cell after the straight
+          cell_t last = location;
+          for (uint8_t i = 0; i < cells; i++) {
+            last = neighbour(last, heading);
+          }
+          cell_t decisionCell = neighbour(last, heading);
+          if (!is_target(decisionCell, target) || s_exploring) {
+            request_plan(target, decisionCell, heading);
+          } else {
+            cancel_plan();
+          }
+          float distance = (cells + 2) * FULL_CELL - 10.0 - forward.position();
+          forward.start(distance, SPEEDMAX_STRAIGHT, SPEEDMAX_EXPLORE, SEARCH_ACCELERATION, SEARCH_DECELERATION);
+          log_status('S');
+          plan_ahead();
+          while (not forward.is_finished()) {
+            delay(2);
+          }
+          forward.set_position(FULL_CELL - 10.0);
+          location = last;
           log_status('x');
           break;
+        }
         case 1: // right
           turn_SS90ER();
           heading = (heading + 1) & 0x03;
@@ -501,110 +673,106 @@ int Mouse::search_to(unsigned char target) {
     delay(250);
   }
   disable_sensors();
+  cancel_plan();
+  clear_pruned_cells();
+#if DSTAR_PLANNER
+  dstar_end();
+#endif
 
   report_status();
   reset_drive_system();
-  return 0;
+  Serial.print(F("Wall conflicts: "));
+  Serial.print(maze_check_conflicts());
+  Serial.print(F(" repairs: "));
+  Serial.print(maze_check_repairs());
+  Serial.print(F(" problems: 0x"));
+  Serial.println(maze_check_problems(), HEX);
+  int saved = save_maze_to_eeprom();
+  Serial.print(F("Maze saved: "));
+  Serial.print(saved);
+  Serial.println(F(" bytes changed"));
+  return result;
+}
+
+/***
+ * The speed at the end of the straight at moves[index]. The mouse only
+ * stops at the end of the path. Before a smooth turn it slows to the
+ * turn speed.
+ */
+static int straight_end_speed(int index, int topSpeed, bool smoothTurns) {
+  move_t next = moves[index + 1];
+  if (next == MOVE_STOP) {
+    return 0;
+  }
+  if (smoothTurns && !(next & MOVE_FORWARD)) {
+    return SPEEDMAX_SMOOTH_TURN;
+  }
+  return topSpeed;
 }
 
 //--------------------------------------------------------------------------
-// assume the maze is flooded and that a simple path string has been generated
+// assume the maze is flooded and that make_path() has filled the move list
 // then run the mouse along the path.
-// run-length encoding of straights is done on the fly.
+// straights are already run-length encoded in half cells.
 // turns are in-place so the mouse stops after each straight.
+// the moves are queued ahead so each one starts as the last one ends.
 //--------------------------------------------------------------------------
-void Mouse::run_in_place_turns(int topSpeed) { // TODO
-  expand_path(path);
-  // debug << path << endl;
-  // debug << commands << endl;
-  // "HRH": in place right
-  // "HLH": in place left
-  // "HH":  half a cell forward
-  // "HS":  end after half a cell
-  int index = 0;
-  while (commands[index] != 'S') {
+void Mouse::run_in_place_turns(int topSpeed) {
+  for (int index = 0; moves[index] != MOVE_STOP; index++) {
     if (button_pressed()) {
+      clear_motion_queue();
       break;
     }
-    if (commands[index] == 'B') {
-      index++;
-    } else if (commands[index] == 'H' && commands[index + 1] == 'R' && commands[index + 2] == 'H') {
-
+    move_t move = moves[index];
+    if (move & MOVE_FORWARD) {
+      int endSpeed = straight_end_speed(index, topSpeed, false);
+      move_forward((move & MAX_STRAIGHT) * HALF_CELL, topSpeed, endSpeed);
+    } else if (move == MOVE_RIGHT) {
       move_forward(HALF_CELL, topSpeed, 0);
-      turn_IP90R();
+      queue_IP90R();
       move_forward(HALF_CELL, topSpeed, topSpeed);
-      index += 3;
-    } else if (commands[index] == 'H' && commands[index + 1] == 'L' && commands[index + 2] == 'H') {
+    } else if (move == MOVE_LEFT) {
       move_forward(HALF_CELL, topSpeed, 0);
-      turn_IP90L();
-      move_forward(HALF_CELL, topSpeed, topSpeed);
-      index += 3;
-    } else if (commands[index] == 'H' && commands[index + 1] == 'H') {
+      queue_IP90L();
       move_forward(HALF_CELL, topSpeed, topSpeed);
-      index++;
-    } else if (commands[index] == 'H' && commands[index + 1] == 'S') {
-      move_forward(HALF_CELL, topSpeed, 0);
-      index++;
     } else {
-      // debug << F("Instruction error!\n");
       break;
     }
   }
+  wait_for_motion_queue();
   // assume we succeed
-  location = maze_goal();
+  location = s_path_end;
+  heading = s_path_end_heading;
   report_status();
 }
 
 //--------------------------------------------------------------------------
-// Assume the maze is flooded and that a path string already exists.
-// Convert that to half-cell straights for easier processing
-// next, convert all HRH and HLH occurrences to the corresponding smooth turns
+// Assume the maze is flooded and that make_path() has filled the move list
 // then run the mouse along the path.
-// run-length encoding of straights is done on the fly.
-// turns are smooth and care is taken to deal with the path end.
+// straights slow down to the turn speed before a smooth turn. The turns
+// replace the half cell either side of the cell centre. The moves are
+// queued ahead so the speed carries from one into the next.
 //--------------------------------------------------------------------------
 void Mouse::run_smooth_turns(int topSpeed) {
-  expand_path(path);
-  // "HRH": smooth right
-  // "HLH": smooth left
-  // "HH":  half a cell forward
-  // "HS":  end after half a cell
-  int index = 0;
-  while (commands[index] != 'S') {
+  for (int index = 0; moves[index] != MOVE_STOP; index++) {
     if (button_pressed()) {
+      clear_motion_queue();
       break;
     }
-    if (commands[index] == 'B') {
-      index++;
-    } else if (commands[index] == 'H' && commands[index + 1] == 'R' && commands[index + 2] == 'H') {
-      move_forward(20, topSpeed, SPEEDMAX_SMOOTH_TURN);
-      // debug << 'R';
-      turnSS90R();
-      move_forward(20, topSpeed, topSpeed);
-      index += 3;
-    } else if (commands[index] == 'H' && commands[index + 1] == 'L' && commands[index + 2] == 'H') {
-      move_forward(20, topSpeed, SPEEDMAX_SMOOTH_TURN);
-      // debug << 'L';
-      turnSS90L();
-      move_forward(20, topSpeed, topSpeed);
-      index += 3;
-    } else if (commands[index] == 'H' && commands[index + 1] == 'H') {
-      // debug << 'H';
-      move_forward(HALF_CELL, topSpeed, topSpeed);
-      ;
-      index++;
-    } else if (commands[index] == 'H' && commands[index + 1] == 'S') {
-      // debug << 'H';
-      move_forward(HALF_CELL, topSpeed, 0);
-      index++;
+    move_t move = moves[index];
+    if (move & MOVE_FORWARD) {
+      int endSpeed = straight_end_speed(index, topSpeed, true);
+      move_forward((move & MAX_STRAIGHT) * HALF_CELL, topSpeed, endSpeed);
+    } else if (move == MOVE_RIGHT || move == MOVE_LEFT) {
+      queue_turn(move, SPEEDMAX_SMOOTH_TURN);
     } else {
-      // debug << F("Instruction error!\n");
       break;
     }
   }
-  // debug << 'S' << endl;
+  wait_for_motion_queue();
   // assume we succeed
-  location = maze_goal();
+  location = s_path_end;
+  heading = s_path_end_heading;
   report_status();
 }
 
@@ -662,57 +830,65 @@ void Mouse::turn_to_face(unsigned char newHeading) {
   heading = newHeading;
 }
 
+/***
+ * Record the walls seen at the sensing point. Walls that are not seen
+ * count as well, so a wall that was misread before can be taken out of
+ * the map again (see maze_check_observe()). The cell and its neighbours
+ * are then checked for impossible walls.
+ */
 void Mouse::update_map() {
-  switch (heading) {
-    case NORTH:
-      if (frontWall) {
-        set_wall_present(location, NORTH);
-      }
-      if (rightWall) {
-        set_wall_present(location, EAST);
-      }
-      if (leftWall) {
-        set_wall_present(location, WEST);
-      }
-      break;
-    case EAST:
-      if (frontWall) {
-        set_wall_present(location, EAST);
-      }
-      if (rightWall) {
-        set_wall_present(location, SOUTH);
-      }
-      if (leftWall) {
-        set_wall_present(location, NORTH);
-      }
-      break;
-    case SOUTH:
-      if (frontWall) {
-        set_wall_present(location, SOUTH);
-      }
-      if (rightWall) {
-        set_wall_present(location, WEST);
-      }
-      if (leftWall) {
-        set_wall_present(location, EAST);
-      }
-      break;
-    case WEST:
-      if (frontWall) {
-        set_wall_present(location, WEST);
-      }
-      if (rightWall) {
-        set_wall_present(location, NORTH);
-      }
-      if (leftWall) {
-        set_wall_present(location, SOUTH);
-      }
+  maze_check_observe(location, heading, frontWall);
+  maze_check_observe(location, (heading + 1) & 0x03, rightWall);
+  maze_check_observe(location, (heading + 3) & 0x03, leftWall);
+  walls[location] |= VISITED;
+  maze_check_cell(location);
+  for (uint8_t direction = 0; direction < 4; direction++) {
+    maze_check_cell(neighbour(location, direction));
+  }
+}
+
+/***
+ * Once the mouse has found the goal, there may still be unvisited cells
+ * that could hold a shorter route. The search carries on from wherever the
+ * mouse is, one leg at a time. Each leg heads for the nearest unvisited
+ * cell on any of the best possible routes to the goal (see
+ * nearest_frontier_cell()). The choice is made again at every cell as new
+ * walls are found. It stops as soon as the maze is solved (see
+ * maze_is_solved()) and never visits cells that cannot affect the result.
+ *
+ * The target can be an unvisited goal cell while the mouse is already in
+ * the goal area, so each leg must get to its exact cell. The targets are
+ * made exact with set_exact_target() while the legs run.
+ *
+ * A leg can find that its target cell cannot be reached. The next leg
+ * then picks another cell from the new best routes. Each leg either
+ * visits a useful cell or walls one off so the search always ends.
+ *
+ * Returns the number of extra legs that were needed
+ */
+int Mouse::explore_until_solved() {
+  int legs = 0;
+  cell_t target;
+  while (!maze_is_solved()) {
+    if (button_pressed()) {
       break;
-    default:
-      // This is an error. We should handle it.
+    }
+    if (!nearest_frontier_cell(location, &target)) {
       break;
+    }
+    Serial.print(F("Exploring to "));
+    print_hex_2(target);
+    Serial.println();
+    s_exploring = true;
+    s_explore_target = target;
+    set_exact_target(true);
+    search_to(target);
+    set_exact_target(false);
+    s_exploring = false;
+    delay(200);
+    legs++;
   }
-  walls[location] |= VISITED;
+  return legs;
 }
 
 /***
@@ -729,10 +905,11 @@ void Mouse::update_map() {
  *
  * A better searcher will continue until a path generated through all
  * cells, regardless of visited state,  does not pass through any
- * unvisited cells.
+ * unvisited cells. That is what explore_until_solved() does before the
+ * mouse heads back to the start.
  *
- * The walls can be saved to EEPROM after each pass. It left to the
- * reader as an exercise to do something useful with that.
+ * The walls are saved to EEPROM at the end of every call to search_to()
+ * so a search can be picked up again after the power has been off.
  */
 int Mouse::search_maze() {
   wait_for_front_sensor();
@@ -743,15 +920,14 @@ int Mouse::search_maze() {
   if (result != 0) {
     panic(1);
   }
-  //  EEPROM.put(0, walls);
   // digitalWrite(RED_LED, 1);
   delay(200);
+  explore_until_solved();
   result = search_to(0);
   stop_motors();
   if (result != 0) {
     panic(1);
   }
-  //    EEPROM.put(0, walls);
   delay(200);
   return 0;
 }
@@ -771,20 +947,27 @@ int Mouse::search_maze() {
 int Mouse::run_maze() {
   // motorsEnable();
   if (p_mouse_state == SEARCHING) {
-    wait_for_front_sensor();
-    handStart = true;
-    enable_steering();
     location = 0;
     heading = NORTH;
-    search_to(maze_goal());
-    search_to(START);
-    turn_to_face(NORTH);
-    delay(200);
+    if (maze_is_solved()) {
+      // the map, perhaps restored from EEPROM, already has the best route
+      Serial.println(F("Maze already solved"));
+    } else {
+      wait_for_front_sensor();
+      handStart = true;
+      enable_steering();
+      search_to(maze_goal());
+      explore_until_solved();
+      search_to(START);
+      turn_to_face(NORTH);
+      delay(200);
+    }
     p_mouse_state = INPLACE_RUN;
   }
   if (p_mouse_state == INPLACE_RUN) {
     flood_maze(maze_goal());
-    make_path(location);
+    make_fastest_path(location, SPEEDMAX_STRAIGHT, false);
+    print_path();
     wait_for_front_sensor();
     Serial.println(F("Running in place"));
     run_in_place_turns(SPEEDMAX_STRAIGHT);
@@ -794,9 +977,10 @@ int Mouse::run_maze() {
     p_mouse_state = SMOOTH_RUN;
   }
   if (p_mouse_state == SMOOTH_RUN) {
-    // now try with smooth turns;
-    flood_maze(maze_goal());
-    make_path(location);
+    // now try with smooth turns, following the fastest route
+    flood_maze_weighted(maze_goal());
+    make_fastest_path(location, SPEEDMAX_STRAIGHT, true);
+    print_path();
     turn_to_face(direction_to_smallest(location, heading));
     delay(200);
     wait_for_front_sensor();
@@ -814,6 +998,7 @@ int Mouse::run_maze() {
 /***
  * Assumes the maze is already flooded to a single target cell and so
  * every cell will have a cost that decreases as the target is approached.
+ * The flood can be a simple cell count or time-weighted.
  *
  * Starting at the given cell, the algorithm repeatedly looks for the
  * smallest available neighbour and records the action taken to reach it.
@@ -827,213 +1012,221 @@ int Mouse::run_maze() {
  * turn to face to the smallest neighbour of that cell using the same
  * method as in this function.
  *
- * The resulting path is a simple string, null terminated, that can be
- * printed to the Serial.to make it easy to compare paths using different
- * flooding or path generating methods.
+ * The result is a list of moves in moves[]. Straights are counted in half
+ * cells and each turn is a single move that takes the half cell either
+ * side of the cell centre with it. The run functions step through the
+ * list without any further processing. There is room for MOVE_LIST_LENGTH
+ * moves. A route that would not fit is cut short at a cell centre so
+ * the mouse still finishes in a known place.
  *
- * The characters in the path string are:
+ * For printing, print_path() turns the list back into a path string
+ * with one character for each cell:
  * 	'B' : always the first character, it marks the path start.
  * 	'F' : move forwards a full cell
- * 	'H' : used in speedruns to indicate movement of half a cell forwards
  * 	'R' : turn right in this cell
  * 	'L' : turn left in this cell
- * 	'A' : turn around (should never happen in a speedrun path)
  * 	'S' : the last character in the path, telling the mouse to stop
  *
  * For example, the Japan2007 maze, flooded with a simple Manhattan
- * flood, should produce the path string:
+ * flood to the default 2x2 goal area, should produce the path string:
  *
- * BFFFRLLRRLLRRLLRFFRRFLLFFLRFRRLLRRLLRFFFFFFFFFRFFFFFRLRLLRRLLRRFFRFFFLFFFS
+ * BFFFRLLRRLLRRLLRFFRRFLLFFLRFRRLLRRLLRFFFFFFFFFRFFFFFRLRLLRRLLRRFFRFFFLFFS
  *
- * The path string is processed by the mouse directly to make it move
- * along the path. At its simplest, this is just a case of executing
- * a single movement for each character in the string, using in-place turns.
- *
- * I would strongly recommend this style of path string. Not only can the
- * strings be used to compare routes very easily, they can be printed and
+ * I would strongly recommend printing paths this way. The strings can
+ * be used to compare routes very easily, they can be printed and
  * visually compared or followed by hand.
  *
- * Path strings are easily translated into more complex paths using
- * smooth turns an they are relatively easy to turn into a set of
- * commands that will represent a diagonal path.
+ * Each step is a lookup in the table of downhill directions made by the
+ * flood so a path takes well under a millisecond. Without the table (see
+ * DOWNHILL_TABLE in maze.h) the neighbour costs are compared at every
+ * step and it can take a few milliseconds. Test 24 reports the actual
+ * times.
  *
- * Further, short path strings  can be hand-generated to test the movement
- * of the mouse or to test the setup of different turn types.
+ * Only the order of the costs matters so the same function will follow
+ * the time-weighted costs from flood_maze_weighted(). One of those two
+ * floods must come just before the call.
  *
- * The pathGenerator is not terribly efficient and can take up to 20ms to
- * generate a path depending on the maze, start cell and target.
+ * Where routes of the same cost split, the first of ahead, right and left
+ * is taken. Each bit of alternatives that is set takes the next one
+ * instead at the matching split along the route, counting from the
+ * first. Splits in the start cell are not counted because the mouse
+ * is assumed to be facing the first cell. The path ends when
+ * it reaches a cell with zero cost, or when it can go no further. When
+ * the flood was to the goal area, that is whichever goal cell is reached
+ * first. The end cell and heading are kept so that the speed runs can
+ * leave the mouse location and heading correct.
  *
  */
 
-bool Mouse::make_path(unsigned char startCell = START) {
+static uint8_t s_path_splits; // routes of the same cost that split on the last path
+
+// the order of preference, in quarter turns to the right
+static const uint8_t turn_order[] = {0, 1, 3, 2};
+
+static uint8_t next_choice(uint8_t exits, uint8_t first, uint8_t heading) {
+  exits &= ~(1 << first);
+  for (uint8_t i = 0; i < 4; i++) {
+    uint8_t direction = (heading + turn_order[i]) & 0x03;
+    if (exits & (1 << direction)) {
+      return direction;
+    }
+  }
+  return first;
+}
+
+bool Mouse::make_path(cell_t startCell, uint16_t alternatives) {
   bool solved = true;
-  ;
-  unsigned char cell = startCell;
-  int nextCost = cost[cell] - 1; // assumes manhattan flood
-  unsigned char commandIndex = 0;
-  path[commandIndex++] = 'B';
-  unsigned char direction = direction_to_smallest(cell, NORTH);
-  while (nextCost >= 0) {
-    unsigned char cmd = 'S';
-    switch (direction) {
-      case NORTH:
-        if (is_exit(cell, NORTH) && neighbour_cost(cell, NORTH) == nextCost) {
-          cmd = 'F';
-          break;
-        }
-        if (is_exit(cell, EAST) && neighbour_cost(cell, EAST) == nextCost) {
-          cmd = 'R';
-          direction = DtoR[direction];
-          break;
-        }
-        if (is_exit(cell, WEST) && neighbour_cost(cell, WEST) == nextCost) {
-          cmd = 'L';
-          direction = DtoL[direction];
-          break;
-        }
-        if (is_exit(cell, SOUTH) && neighbour_cost(cell, SOUTH) == nextCost) {
-          cmd = 'A';
-          direction = DtoB[direction];
-        }
-        break;
-      case EAST:
-        if (is_exit(cell, EAST) && neighbour_cost(cell, EAST) == nextCost) {
-          cmd = 'F';
-          break;
-        }
-        if (is_exit(cell, SOUTH) && neighbour_cost(cell, SOUTH) == nextCost) {
-          cmd = 'R';
-          direction = DtoR[direction];
-          break;
-        }
-        if (is_exit(cell, NORTH) && neighbour_cost(cell, NORTH) == nextCost) {
-          cmd = 'L';
-          direction = DtoL[direction];
-          break;
-        }
-        if (is_exit(cell, WEST) && neighbour_cost(cell, WEST) == nextCost) {
-          cmd = 'A';
-          direction = DtoB[direction];
-          break;
-        }
-        break;
-      case SOUTH:
-        if (is_exit(cell, SOUTH) && neighbour_cost(cell, SOUTH) == nextCost) {
-          cmd = 'F';
-          break;
-        }
-        if (is_exit(cell, WEST) && neighbour_cost(cell, WEST) == nextCost) {
-          direction = DtoR[direction];
-          cmd = 'R';
-          break;
-        }
-        if (is_exit(cell, EAST) && neighbour_cost(cell, EAST) == nextCost) {
-          cmd = 'L';
-          direction = DtoL[direction];
-          break;
-        }
-        if (is_exit(cell, NORTH) && neighbour_cost(cell, NORTH) == nextCost) {
-          cmd = 'A';
-          direction = DtoB[direction];
-          break;
-        }
-        break;
-      case WEST:
-        if (is_exit(cell, WEST) && neighbour_cost(cell, WEST) == nextCost) {
-          cmd = 'F';
-          break;
-        }
-        if (is_exit(cell, NORTH) && neighbour_cost(cell, NORTH) == nextCost) {
-          cmd = 'R';
-          direction = DtoR[direction];
-          break;
-        }
-        if (is_exit(cell, SOUTH) && neighbour_cost(cell, SOUTH) == nextCost) {
-          cmd = 'L';
-          direction = DtoL[direction];
-          break;
-        }
-        if (is_exit(cell, EAST) && neighbour_cost(cell, EAST) == nextCost) {
-          cmd = 'A';
-          direction = DtoB[direction];
-          break;
-        }
-        break;
-      default:
-        // this is an error. We should handle it.
-        break;
+  cell_t cell = startCell;
+  int count = 0;
+  uint8_t halfCells = 0;
+  s_path_splits = 0;
+  unsigned char direction = downhill_direction(cell, NORTH);
+  // leave room for a straight, a turn and the final straight and stop
+  while (cost[cell] > 0 && cost[cell] < MAX_COST && count < MOVE_LIST_LENGTH - 4) {
+    unsigned char newDirection = downhill_direction(cell, direction);
+    uint8_t exits = downhill_exits(cell);
+    if (cell != startCell && (exits & (exits - 1))) {
+      if (s_path_splits < MAX_PATH_SPLITS && (alternatives & (1u << s_path_splits))) {
+        newDirection = next_choice(exits, newDirection, direction);
+      }
+      s_path_splits++;
+    }
+    // 0 is ahead, 1 is right, 2 is behind, 3 is left
+    unsigned char turn = (newDirection - direction) & 0x03;
+    if (turn == 2) {
+      break; // turning around is never downhill
+    }
+    if (turn == 0) {
+      if (halfCells > MAX_STRAIGHT - 2) {
+        moves[count++] = MOVE_FORWARD | halfCells;
+        halfCells = 0;
+      }
+      halfCells += 2;
+    } else {
+      // the turn uses the last half cell of the straight before it
+      if (halfCells > 1) {
+        moves[count++] = MOVE_FORWARD | (halfCells - 1);
+      }
+      moves[count++] = (turn == 1) ? MOVE_RIGHT : MOVE_LEFT;
+      // and the first half cell after it
+      halfCells = 1;
     }
+    direction = newDirection;
     cell = neighbour(cell, direction);
     if ((walls[cell] & VISITED) != VISITED) {
       solved = false;
     }
-    nextCost--;
-    path[commandIndex] = cmd;
-    commandIndex++;
   }
-  path[commandIndex] = 'S';
-  commandIndex++;
-  path[commandIndex] = '\0';
+  if (halfCells > 0) {
+    moves[count++] = MOVE_FORWARD | halfCells;
+  }
+  moves[count] = MOVE_STOP;
+  s_path_end = cell;
+  s_path_end_heading = direction;
   return solved;
 }
 
 /***
- * Assumes that the maze is flooded and a path string has been generated.
- *
- * Convert  the simple path string to a set of commands using half-cell
- * moves instead of full-cell moves so that a sequence like
- * 		BFRFLS
- * becomes
- * 		BHHRHHHHLHHS
- *
- * The turns all have an implied full cell forward movement after them
- * The only real advantage of this is that it is easier to convert to smooth
- * turns by looking for patterns like HRH and HLH
- *
+ * The time, in seconds, to cover the distance from the given speed. The
+ * speed is updated to the speed at the end of the move.
+ */
+static float forward_time(float &speed, float distance, float topSpeed, float endSpeed) {
+  float time = profile_time(distance, speed, topSpeed, endSpeed, SEARCH_ACCELERATION, SEARCH_DECELERATION);
+  speed = profile_end_speed(distance, speed, topSpeed, endSpeed, SEARCH_ACCELERATION, SEARCH_DECELERATION);
+  return time;
+}
 
+/***
+ * Estimate how long, in seconds, run_in_place_turns() or run_smooth_turns()
+ * will take to follow the move list. Each move is timed with the same
+ * distances, speeds and accelerations that the run uses, following the
+ * trapezoid of the Profile. Turns are timed from the rotation profile.
+ * Steering, sensor delays and the time taken to start each move are
+ * ignored so a real run will be a little slower.
  */
-void Mouse::expand_path(char *pathString) {
-  int pathIndex = 0;
-  int commandIndex = 0;
-  commands[commandIndex++] = 'B';
-  while (char c = pathString[pathIndex]) {
-    switch (c) {
-      case 'F':
-        commands[commandIndex++] = 'H';
-        commands[commandIndex++] = 'H';
-        pathIndex++;
-        break;
-      case 'R':
-        commands[commandIndex++] = 'R';
-        commands[commandIndex++] = 'H';
-        commands[commandIndex++] = 'H';
-        pathIndex++;
-        break;
-      case 'L':
-        commands[commandIndex++] = 'L';
-        commands[commandIndex++] = 'H';
-        commands[commandIndex++] = 'H';
-        pathIndex++;
-        break;
-      case 'S':
-        commands[commandIndex++] = 'S';
-        pathIndex++;
-        break;
-      case 'B':
-      case ' ': // ignore these so we can write easy-to-read path strings
-        pathIndex++;
-        break;
-      default:
-        // TODO: this is an error. We should handle it.
-        break;
+float Mouse::estimate_run_time(int topSpeed, bool smoothTurns) {
+  float speed = 0;
+  float time = 0;
+  for (int index = 0; moves[index] != MOVE_STOP; index++) {
+    move_t move = moves[index];
+    if (move & MOVE_FORWARD) {
+      int endSpeed = straight_end_speed(index, topSpeed, smoothTurns);
+      time += forward_time(speed, (move & MAX_STRAIGHT) * HALF_CELL, topSpeed, endSpeed);
+    } else if (smoothTurns) {
+      time += turn_time(move, SPEEDMAX_SMOOTH_TURN);
+    } else {
+      time += forward_time(speed, HALF_CELL, topSpeed, 0);
+      time += profile_time(90, 0, SPEEDMAX_SPIN_TURN, 0, SPIN_TURN_ACCELERATION);
+      time += forward_time(speed, HALF_CELL, topSpeed, topSpeed);
     }
   }
-  commands[commandIndex] = '\0';
+  return time;
 }
 
+/***
+ * Often there are several routes with the same cost. This makes the path
+ * that make_path() would and then tries the other way at each of the
+ * first MAX_PATH_SPLITS places where routes split, one at a time. Any
+ * change that makes the estimated run faster is kept. That is a bounded
+ * search. No more than MAX_PATH_SPLITS + 1 paths are made so it only
+ * takes a moment, even on the ATmega328. It will not always find the very
+ * fastest route.
+ *
+ * A route through cells that have not been visited is never chosen over
+ * one that has been visited all the way. Returns true if every cell on
+ * the chosen path has been visited.
+ */
+bool Mouse::make_fastest_path(cell_t startCell, int topSpeed, bool smoothTurns) {
+  uint16_t best = 0;
+  bool solved = make_path(startCell, best);
+  float bestTime = estimate_run_time(topSpeed, smoothTurns);
+  uint8_t splits = s_path_splits;
+  for (uint8_t i = 0; i < splits && i < MAX_PATH_SPLITS; i++) {
+    uint16_t trial = best | (1u << i);
+    bool trialSolved = make_path(startCell, trial);
+    float time = estimate_run_time(topSpeed, smoothTurns);
+    if (time < bestTime && (trialSolved || !solved)) {
+      best = trial;
+      bestTime = time;
+      solved = trialSolved;
+      splits = s_path_splits;
+    }
+  }
+  return make_path(startCell, best);
+}
+
+/***
+ * Print the move list as a path string with one character for each cell.
+ *
+ * Every cell is two half cells. A turn is printed in place of the cell it
+ * is made in so the half cell before it still belongs to the previous
+ * cell and the one after it starts the turning cell.
+ *
+ * The estimated run times with in-place and smooth turns follow the path.
+ */
 void Mouse::print_path() {
-  for (int i = 0; i < 128 && path[i]; i++) {
-    Serial.print(path[i]);
+  Serial.print('B');
+  uint8_t owed = 0; // half cells still to come in the last cell printed
+  for (int i = 0; moves[i] != MOVE_STOP; i++) {
+    move_t move = moves[i];
+    if (move & MOVE_FORWARD) {
+      for (uint8_t h = move & MAX_STRAIGHT; h > 0; h--) {
+        if (owed > 0) {
+          owed--;
+        } else {
+          Serial.print('F');
+          owed = 1;
+        }
+      }
+    } else {
+      Serial.print(move == MOVE_RIGHT ? 'R' : 'L');
+      owed = 1; // the half cell after the turn
+    }
   }
-  Serial.println();
+  Serial.print('S');
+  Serial.print(F("  in place "));
+  Serial.print(estimate_run_time(SPEEDMAX_STRAIGHT, false), 2);
+  Serial.print(F("s  smooth "));
+  Serial.print(estimate_run_time(SPEEDMAX_STRAIGHT, true), 2);
+  Serial.println('s');
 }
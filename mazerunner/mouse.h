@@ -33,13 +33,44 @@
 #ifndef MOUSE_H
 #define MOUSE_H
 
+#include "maze.h"
+
 #define SEARCH_ACCELERATION 3000
+#define SEARCH_DECELERATION 3000
 #define SPIN_TURN_ACCELERATION 3600
 #define SPEEDMAX_EXPLORE 400
 #define SPEEDMAX_STRAIGHT 800
 #define SPEEDMAX_SMOOTH_TURN 500
 #define SPEEDMAX_SPIN_TURN 360
 
+/***
+ * A route is kept as a list of moves, one byte each. A straight has
+ * MOVE_FORWARD set and the number of half cells in the low bits. The
+ * turns take the half cell either side of the cell centre with them.
+ * The list always ends with MOVE_STOP.
+ */
+#define MOVE_LIST_LENGTH 128
+#define MOVE_FORWARD 0x80
+#define MAX_STRAIGHT 0x7F
+
+typedef uint8_t move_t;
+
+enum {
+  MOVE_STOP = 0,
+  MOVE_RIGHT = 1,
+  MOVE_LEFT = 2,
+};
+
+// prune dead ends and unreachable cells from the floods during a search
+#define SEARCH_PRUNING 1
+
+// cross visited cells on a straight route in one faster move during a search
+#define SEARCH_STRAIGHTS 1
+
+// make_fastest_path() tries the other way at this many places where equal
+// routes split. No more than 16.
+#define MAX_PATH_SPLITS 16
+
 enum {
   FRESH_START,
   SEARCHING,
@@ -62,19 +93,21 @@ class Mouse {
   void turn_SS90ER();
   void turn_around();
   void end_run();
-  int search_to(unsigned char target);
-  void follow_to(unsigned char target);
+  int search_to(cell_t target);
+  void follow_to(cell_t target);
   void run_in_place_turns(int top_speed);
   void run_smooth_turns(int top_speed);
   void update_map();
+  int explore_until_solved();
   int search_maze();
   int run_maze();
-  bool make_path(unsigned char startCell);
-  void expand_path(char *pathString);
+  bool make_path(cell_t startCell, uint16_t alternatives = 0);
+  bool make_fastest_path(cell_t startCell, int topSpeed, bool smoothTurns);
+  float estimate_run_time(int topSpeed, bool smoothTurns);
   void print_path();
 
   unsigned char heading;
-  unsigned char location;
+  cell_t location;
   bool leftWall;
   bool frontWall;
   bool rightWall;
@@ -83,8 +116,7 @@ class Mouse {
 
 extern char p_mouse_state;
 
-extern char path[];
-extern char commands[];
+extern move_t moves[];
 
 extern Mouse dorothy;
 
@@ -34,6 +34,7 @@
 #define PROFILE_H
 
 #include "encoders.h"
+#include "ramp_table.h"
 #include "settings.h"
 #include <Arduino.h>
 #include <util/atomic.h>
@@ -50,6 +51,23 @@ enum ProfileState : uint8_t {
   CS_FINISHED = 3,
 };
 
+/***
+ * Reads the ramp table at a phase from 0 to 65535, with a straight line
+ * between the entries. The result is the fraction of full speed as 0 to
+ * 65535. Used by the profiles to play back a move.
+ */
+inline uint16_t ramp_level(uint16_t phase) {
+  const uint8_t shift = 16 - RAMP_TABLE_BITS;
+  uint8_t i = phase >> shift;
+  uint16_t a = pgm_read_word(&ramp_table[i]);
+  uint16_t b = pgm_read_word(&ramp_table[i + 1]);
+  uint16_t fraction = phase & ((1 << shift) - 1);
+  return a + (uint16_t)(((uint32_t)(b - a) * fraction) >> shift);
+}
+
+#if FIXED_POINT_CONTROL
+#include "profile_fixed.h"
+#else
 class Profile {
   public:
   void reset() {
@@ -57,6 +75,8 @@ class Profile {
       m_position = 0;
       m_speed = 0;
       m_target_speed = 0;
+      m_accel = 0;
+      m_playback = false;
       m_state = CS_IDLE;
     }
   }
@@ -70,7 +90,11 @@ class Profile {
 
   bool is_finished() { return m_state == CS_FINISHED; }
 
-  void start(float distance, float top_speed, float final_speed, float acceleration) {
+  /***
+   * The deceleration is used whenever the speed is brought down. Leave it
+   * out, or make it zero, to use the acceleration for both.
+   */
+  void start(float distance, float top_speed, float final_speed, float acceleration, float deceleration = 0) {
     m_sign = (distance < 0) ? -1 : +1;
     if (distance < 0) {
       distance = -distance;
@@ -88,11 +112,57 @@ class Profile {
     m_target_speed = m_sign * fabsf(top_speed);
     m_final_speed = m_sign * fabsf(final_speed);
     m_acceleration = fabsf(acceleration);
-    if (m_acceleration >= 1) {
-      m_one_over_acc = 1.0f / m_acceleration;
+    m_deceleration = (deceleration > 0) ? fabsf(deceleration) : m_acceleration;
+    if (m_deceleration >= 1) {
+      m_one_over_dec = 1.0f / m_deceleration;
     } else {
-      m_one_over_acc = 1.0;
+      m_one_over_dec = 1.0;
+    }
+    m_brake_step = m_deceleration * LOOP_INTERVAL;
+    // a jerk that gets to full acceleration in one tick is no limit at all
+    m_s_curve = m_jerk > 0 && m_jerk * LOOP_INTERVAL < max(m_acceleration, m_deceleration);
+    m_playback = false;
+    m_state = CS_ACCELERATING;
+  }
+
+  /***
+   * Rather than work out the speed every tick, this plays it back from the
+   * ramp table. The speed follows the table up to the top speed over
+   * ramp_ticks, holds there and then follows the table back down to rest.
+   * Every shape in the table turns through half as much in a ramp as the
+   * top speed would, so the top speed only has to be trimmed a little for
+   * the move to take a whole number of ticks and cover the distance
+   * exactly. It always takes the same ticks and steps for the same move.
+   */
+  void start_playback(float distance, float top_speed, uint16_t ramp_ticks) {
+    m_sign = (distance < 0) ? -1 : +1;
+    distance = fabsf(distance);
+    if (distance < 1.0) {
+      m_state = CS_FINISHED;
+      return;
     }
+    ramp_ticks = max(ramp_ticks, (uint16_t)1);
+    float ticks = distance / (max(fabsf(top_speed), 1.0f) * LOOP_INTERVAL) - ramp_ticks;
+    uint16_t hold = (uint16_t)constrain(ticks + 0.5f, 0.0f, 30000.0f);
+    float peak = distance / ((ramp_ticks + hold) * LOOP_INTERVAL);
+    m_position = 0;
+    m_final_position = distance;
+    m_peak_speed = m_sign * peak;
+    m_play_scale = m_peak_speed / 65535;
+    m_target_speed = m_peak_speed;
+    m_final_speed = 0;
+    // only used to bring the last little bit of speed down afterwards
+    m_acceleration = max(peak / (ramp_ticks * LOOP_INTERVAL), 1.0f);
+    m_deceleration = m_acceleration;
+    m_one_over_dec = 1.0f / m_deceleration;
+    m_brake_step = m_deceleration * LOOP_INTERVAL;
+    m_s_curve = false;
+    m_ramp_ticks = ramp_ticks;
+    m_down_tick = ramp_ticks + hold;
+    m_play_tick = 0;
+    m_phase_step = 65536UL / ramp_ticks;
+    m_phase = m_phase_step / 2;
+    m_playback = true;
     m_state = CS_ACCELERATING;
   }
 
@@ -106,14 +176,57 @@ class Profile {
   void finish() {
     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
       m_speed = m_target_speed;
+      m_accel = 0;
+      m_playback = false;
       m_state = CS_FINISHED;
     }
   }
 
   void set_state(ProfileState state) { m_state = state; }
 
+  /***
+   * A jerk limit, in units/s/s/s, turns the trapezoid into an S-curve. The
+   * acceleration is ramped up and down rather than switched on and off,
+   * which is much kinder to the tyres. Zero gives the plain trapezoid.
+   * The setting is kept from one start() to the next and is picked up by
+   * the next start().
+   */
+  void set_jerk(float jerk) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      m_jerk = fabsf(jerk);
+      m_accel = 0;
+    }
+  }
+
+  /***
+   * The distance needed to get from the current speed to the final speed.
+   * With a jerk limit, the deceleration takes time to build up and to die
+   * away again. The braking speed profile is symmetrical, so the distance
+   * is just the average speed times the time taken. Any acceleration
+   * still in progress has to be taken out first and that adds a little
+   * more speed and distance.
+   */
   float get_braking_distance() {
-    return fabsf(m_speed * m_speed - m_final_speed * m_final_speed) * 0.5 * m_one_over_acc;
+    if (!m_s_curve) {
+      return fabsf(m_speed * m_speed - m_final_speed * m_final_speed) * 0.5 * m_one_over_dec;
+    }
+    float v = fabsf(m_speed);
+    float v_final = fabsf(m_final_speed);
+    float distance = 0;
+    if (m_accel > 0) {
+      float t = m_accel / m_jerk;
+      float v_extra = 0.5f * m_accel * t;
+      distance = (v + 0.6667f * v_extra) * t;
+      v += v_extra;
+    }
+    float dv = fabsf(v - v_final);
+    if (dv * m_jerk < m_deceleration * m_deceleration) {
+      // never reaches the full deceleration
+      return distance + (v + v_final) * sqrtf(dv / m_jerk);
+    }
+    // the trapezoid distance plus the time lost to the jerk limit
+    distance += fabsf(v * v - v_final * v_final) * 0.5f * m_one_over_dec;
+    return distance + 0.5f * (v + v_final) * m_deceleration / m_jerk;
   }
 
   float position() {
@@ -148,6 +261,14 @@ class Profile {
     return acc;
   }
 
+  float deceleration() {
+    float dec;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      dec = m_deceleration;
+    }
+    return dec;
+  }
+
   void set_speed(float speed) {
     ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
       m_speed = speed;
@@ -173,7 +294,10 @@ class Profile {
     if (m_state == CS_IDLE) {
       return;
     }
-    float delta_v = m_acceleration * LOOP_INTERVAL;
+    if (m_playback) {
+      update_playback();
+      return;
+    }
     float remaining = fabsf(m_final_position) - fabsf(m_position);
     if (m_state == CS_ACCELERATING) {
       if (remaining < get_braking_distance()) {
@@ -183,39 +307,193 @@ class Profile {
         } else {
           m_target_speed = m_final_speed;
         };
+        if (!m_s_curve) {
+          m_brake_step = braking_step(remaining);
+        }
       }
     }
     // try to reach the target speed
-    if (m_speed < m_target_speed) {
-      m_speed += delta_v;
-      if (m_speed > m_target_speed) {
-        m_speed = m_target_speed;
+    if (m_s_curve) {
+      update_s_curve_speed();
+    } else {
+      // the gap is positive when the speed has to go up in the direction of travel
+      float gap = (m_target_speed - m_speed) * m_sign;
+      float delta_v = m_deceleration * LOOP_INTERVAL;
+      if (gap > 0) {
+        delta_v = m_acceleration * LOOP_INTERVAL;
+      } else if (m_state == CS_BRAKING) {
+        delta_v = m_brake_step;
       }
-    }
-    if (m_speed > m_target_speed) {
-      m_speed -= delta_v;
       if (m_speed < m_target_speed) {
-        m_speed = m_target_speed;
+        m_speed += delta_v;
+        if (m_speed > m_target_speed) {
+          m_speed = m_target_speed;
+        }
+      }
+      if (m_speed > m_target_speed) {
+        m_speed -= delta_v;
+        if (m_speed < m_target_speed) {
+          m_speed = m_target_speed;
+        }
       }
     }
     // increment the position
-    m_position += m_speed * LOOP_INTERVAL;
-    if (m_state != CS_FINISHED && remaining < 0.125) {
+    float step = m_speed * LOOP_INTERVAL;
+    m_position += step;
+    // finish on the tick that ends nearest the end so that a following move starts in the right place
+    step = fabsf(step);
+    if (m_state != CS_FINISHED && remaining - step < max(0.125f, 0.5f * step)) {
       m_state = CS_FINISHED;
       m_target_speed = m_final_speed;
     }
   }
 
   private:
+  /***
+   * The ramp samples are taken half a step in from each end so that the
+   * ramp down uses exactly the same samples as the ramp up, in reverse.
+   */
+  void update_playback() {
+    if (m_play_tick < m_ramp_ticks) {
+      m_speed = m_play_scale * ramp_level(m_phase);
+      m_phase += m_phase_step;
+    } else if (m_play_tick < m_down_tick) {
+      m_speed = m_peak_speed;
+    } else {
+      m_state = CS_BRAKING;
+      m_phase -= m_phase_step;
+      m_speed = m_play_scale * ramp_level(m_phase);
+    }
+    m_play_tick++;
+    m_position += m_speed * LOOP_INTERVAL;
+    if (m_play_tick >= m_down_tick + m_ramp_ticks) {
+      m_playback = false;
+      m_target_speed = 0;
+      m_state = CS_FINISHED;
+    }
+  }
+
+  /***
+   * Braking starts up to a tick late and the speed comes down in whole
+   * steps, so the set deceleration would stop a little short or long. That
+   * leaves the profile creeping to the end, which can take many ticks. The
+   * speed change per tick is worked out once, here, so that the speed
+   * reaches the target just as the distance runs out. It is rarely more
+   * than a few percent away from the set deceleration.
+   */
+  float braking_step(float remaining) {
+    float v = fabsf(m_speed);
+    float v_end = fabsf(m_target_speed);
+    float distance = remaining + (v - v_end) * LOOP_INTERVAL * 0.5f;
+    if (v <= v_end || distance <= 0) {
+      return m_deceleration * LOOP_INTERVAL;
+    }
+    return (v * v - v_end * v_end) / (2 * distance) * LOOP_INTERVAL;
+  }
+
+  /***
+   * Everything here is worked in the direction of travel so that speeding
+   * up is always positive. The acceleration heads for its limit until it
+   * would need all of the remaining speed change just to ramp back down
+   * to zero. Then it heads for zero. That is a simple bang-bang rule that
+   * needs no square roots so it is cheap enough for the systick ISR.
+   * The last step snaps to the target speed so there is no hunting.
+   */
+  void update_s_curve_speed() {
+    float gap = (m_target_speed - m_speed) * m_sign;
+    float goal = 0;
+    if (gap > 0) {
+      goal = m_acceleration;
+      if (m_accel > 0 && m_accel * m_accel >= 2 * m_jerk * gap) {
+        goal = 0;
+      }
+    } else if (gap < 0) {
+      goal = -m_deceleration;
+      if (m_accel < 0 && m_accel * m_accel >= -2 * m_jerk * gap) {
+        goal = 0;
+      }
+    }
+    float delta_a = m_jerk * LOOP_INTERVAL;
+    if (m_accel < goal) {
+      m_accel = min(m_accel + delta_a, goal);
+    } else {
+      m_accel = max(m_accel - delta_a, goal);
+    }
+    float delta_v = m_accel * LOOP_INTERVAL;
+    if ((gap > 0 && delta_v >= gap) || (gap < 0 && delta_v <= gap) || gap == 0) {
+      m_speed = m_target_speed;
+      m_accel = 0;
+    } else {
+      m_speed += m_sign * delta_v;
+    }
+  }
+
   volatile uint8_t m_state = CS_IDLE;
   volatile float m_speed = 0;
   volatile float m_position = 0;
   int8_t m_sign = 1;
   float m_acceleration = 0;
-  float m_one_over_acc = 1;
+  float m_deceleration = 0;
+  float m_one_over_dec = 1;
+  float m_brake_step = 0;
+  float m_jerk = 0;
+  bool m_s_curve = false;
+  float m_accel = 0; // the current acceleration of an S-curve
   float m_target_speed = 0;
   float m_final_speed = 0;
   float m_final_position = 0;
+  bool m_playback = false;
+  uint16_t m_ramp_ticks = 0;
+  uint16_t m_down_tick = 0; // the tick when the ramp down starts
+  uint16_t m_play_tick = 0;
+  uint32_t m_phase = 0; // Q.16 position in the ramp table
+  uint32_t m_phase_step = 0;
+  float m_peak_speed = 0;
+  float m_play_scale = 0; // the speed for each step of ramp_level()
 };
+#endif
+
+/***
+ * The time, in seconds, for the trapezoid that update() follows over the
+ * given distance. It starts at v_start, speeds up towards v_max and
+ * brakes at the last moment to finish at v_end. A short move may never
+ * reach v_max. If the move is too short to reach v_end at all, the speed
+ * changes the whole way. Use profile_end_speed() to find what the speed
+ * really is at the end. As with start(), a deceleration of zero means
+ * the same rate as the acceleration. Any jerk limit is ignored.
+ */
+inline float profile_time(float distance, float v_start, float v_max, float v_end, float acceleration, float deceleration = 0) {
+  if (deceleration <= 0) {
+    deceleration = acceleration;
+  }
+  v_end = min(v_end, v_max);
+  float up = (v_max * v_max - v_start * v_start) / (2 * acceleration);
+  float down = (v_max * v_max - v_end * v_end) / (2 * deceleration);
+  if (up + down <= distance) {
+    return (v_max - v_start) / acceleration + (v_max - v_end) / deceleration + (distance - (up + down)) / v_max;
+  }
+  float v_peak_squared = (2 * acceleration * deceleration * distance + deceleration * v_start * v_start + acceleration * v_end * v_end) / (acceleration + deceleration);
+  if (v_peak_squared < v_start * v_start || v_peak_squared < v_end * v_end) {
+    if (v_end > v_start) {
+      float v = sqrt(v_start * v_start + 2 * acceleration * distance);
+      return (v - v_start) / acceleration;
+    }
+    float v = sqrt(max(v_start * v_start - 2 * deceleration * distance, 0.0f));
+    return (v_start - v) / deceleration;
+  }
+  float v_peak = sqrt(v_peak_squared);
+  return (v_peak - v_start) / acceleration + (v_peak - v_end) / deceleration;
+}
+
+inline float profile_end_speed(float distance, float v_start, float v_max, float v_end, float acceleration, float deceleration = 0) {
+  if (deceleration <= 0) {
+    deceleration = acceleration;
+  }
+  v_end = min(v_end, v_max);
+  if (v_end > v_start) {
+    return min(v_end, (float)sqrt(v_start * v_start + 2 * acceleration * distance));
+  }
+  return max(v_end, (float)sqrt(max(v_start * v_start - 2 * deceleration * distance, 0.0f)));
+}
 
 #endif
\ No newline at end of file
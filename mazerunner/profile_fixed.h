@@ -0,0 +1,496 @@
+/*
+ * File: profile_fixed.h
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+
+#ifndef PROFILE_FIXED_H
+#define PROFILE_FIXED_H
+
+/***
+ * This is the fixed point version of the Profile class. It is only
+ * included from profile.h, when FIXED_POINT_CONTROL is set, and it has
+ * the same interface as the float version so the rest of the code does
+ * not need to know which one it has.
+ *
+ * Positions are Q16.16. Speeds are Q8.24 in units per tick so that the
+ * position update is an add. Accelerations and jerk are kept as the
+ * speed change per tick. The valid range is a distance of 32767 units
+ * and a speed of about 4000 units per second.
+ *
+ * The S-curve keeps the acceleration as a whole number of jerk steps.
+ * A jerk limit that gets to full acceleration in a single tick is no
+ * limit at all, so the plain trapezoid is used then. The jerk limit is
+ * picked up by the next start().
+ *
+ * A played back move reads the ramp table and scales it by the top speed
+ * cut down to Q.12, so a tick costs one short multiply.
+ */
+
+#include "fixed.h"
+
+// convert units/s and units/s/s to the Q8.24 changes per tick
+const float TICK_SPEED = 16777216.0f * LOOP_INTERVAL;
+const float TICK_ACCELERATION = TICK_SPEED * LOOP_INTERVAL;
+const int32_t CREEP_SPEED = (int32_t)(5.0f * TICK_SPEED);
+const fixed_t FINISH_WINDOW = FIXED_ONE / 8;
+const int32_t MAX_RAMP = 1000; // ticks
+
+class Profile {
+  public:
+  void reset() {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      m_position = 0;
+      m_speed = 0;
+      m_target_speed = 0;
+      m_ramp = 0;
+      m_playback = false;
+      m_state = CS_IDLE;
+    }
+  }
+
+  // not used?
+  void clear_counters() {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      m_position = 0;
+    }
+  }
+
+  bool is_finished() { return m_state == CS_FINISHED; }
+
+  /***
+   * All the float arithmetic is done here, in the foreground, so that
+   * update() has only integers to deal with.
+   */
+  void start(float distance, float top_speed, float final_speed, float acceleration, float deceleration = 0) {
+    int8_t sign = (distance < 0) ? -1 : +1;
+    if (distance < 0) {
+      distance = -distance;
+    }
+    if (distance < 1.0) {
+      m_sign = sign;
+      m_state = CS_FINISHED;
+      return;
+    }
+    if (final_speed > top_speed) {
+      final_speed = top_speed;
+    }
+    m_acceleration = fabsf(acceleration);
+    m_deceleration = (deceleration > 0) ? fabsf(deceleration) : m_acceleration;
+    int32_t acc_step = max((int32_t)(m_acceleration * TICK_ACCELERATION + 0.5f), (int32_t)1);
+    int32_t dec_step = max((int32_t)(m_deceleration * TICK_ACCELERATION + 0.5f), (int32_t)1);
+    // 1/(2 x deceleration) in ticks squared per unit, as Q.6
+    float dec = max(m_deceleration, 1.0f) * LOOP_INTERVAL * LOOP_INTERVAL;
+    uint32_t brake_k = max((uint32_t)(32.0f / dec + 0.5f), (uint32_t)1);
+    uint16_t ramp_up = 0;
+    uint16_t ramp_down = 0;
+    uint32_t short_brake_k = 0;
+    if (m_jerk > 0) {
+      float ticks_up = ceilf(m_acceleration / m_jerk * LOOP_FREQUENCY);
+      float ticks_down = ceilf(m_deceleration / m_jerk * LOOP_FREQUENCY);
+      if (ticks_up > 1 || ticks_down > 1) {
+        // the products of a step and a ramp length must fit in 31 bits
+        ramp_up = constrain(ticks_up, 1, min(MAX_RAMP, INT32_MAX / acc_step));
+        ramp_down = constrain(ticks_down, 1, min(MAX_RAMP, INT32_MAX / dec_step));
+        // 2^38 divided by the speed change that needs all of the ramp time
+        short_brake_k = (uint32_t)(274877906944.0f / ((float)dec_step * ramp_down));
+      }
+    }
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      m_sign = sign;
+      m_position = 0;
+      m_final_position = to_fixed(distance);
+      m_target_speed = sign * to_tick_speed(fabsf(top_speed));
+      m_final_speed = sign * to_tick_speed(fabsf(final_speed));
+      m_acc_step = acc_step;
+      m_dec_step = dec_step;
+      m_brake_step = dec_step;
+      m_brake_k = brake_k;
+      m_brake_limit = INT32_MAX / brake_k;
+      m_ramp_up = ramp_up;
+      m_ramp_down = ramp_down;
+      m_jerk_up = ramp_up ? acc_step / ramp_up : 0;
+      m_jerk_down = ramp_down ? dec_step / ramp_down : 0;
+      m_short_brake_k = short_brake_k;
+      m_ramp = constrain(m_ramp, -ramp_down, ramp_up);
+      m_playback = false;
+      m_state = CS_ACCELERATING;
+    }
+  }
+
+  /***
+   * See the float version. The top speed is trimmed here so that update()
+   * only has the table to read.
+   */
+  void start_playback(float distance, float top_speed, uint16_t ramp_ticks) {
+    int8_t sign = (distance < 0) ? -1 : +1;
+    distance = fabsf(distance);
+    if (distance < 1.0) {
+      m_sign = sign;
+      m_state = CS_FINISHED;
+      return;
+    }
+    ramp_ticks = max(ramp_ticks, (uint16_t)1);
+    float ticks = distance / (max(fabsf(top_speed), 1.0f) * LOOP_INTERVAL) - ramp_ticks;
+    uint16_t hold = (uint16_t)constrain(ticks + 0.5f, 0.0f, 30000.0f);
+    float peak = distance / ((ramp_ticks + hold) * LOOP_INTERVAL);
+    m_acceleration = peak / (ramp_ticks * LOOP_INTERVAL);
+    m_deceleration = m_acceleration;
+    // only used to bring the last little bit of speed down afterwards
+    int32_t step = max((int32_t)(m_acceleration * TICK_ACCELERATION + 0.5f), (int32_t)1);
+    int32_t peak_speed = to_tick_speed(peak);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      m_sign = sign;
+      m_position = 0;
+      m_final_position = to_fixed(distance);
+      m_peak_speed = sign * peak_speed;
+      m_play_scale = (peak_speed + 2048) >> 12;
+      m_target_speed = m_peak_speed;
+      m_final_speed = 0;
+      m_acc_step = step;
+      m_dec_step = step;
+      m_brake_step = step;
+      m_ramp_up = 0;
+      m_ramp_down = 0;
+      m_ramp = 0;
+      m_ramp_ticks = ramp_ticks;
+      m_down_tick = ramp_ticks + hold;
+      m_play_tick = 0;
+      m_phase_step = 65536UL / ramp_ticks;
+      m_phase = m_phase_step / 2;
+      m_playback = true;
+      m_state = CS_ACCELERATING;
+    }
+  }
+
+  void stop() {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      m_target_speed = 0;
+    }
+    finish();
+  }
+
+  void finish() {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      m_speed = m_target_speed;
+      m_ramp = 0;
+      m_playback = false;
+      m_state = CS_FINISHED;
+    }
+  }
+
+  void set_state(ProfileState state) { m_state = state; }
+
+  void set_jerk(float jerk) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      m_jerk = fabsf(jerk);
+      m_ramp = 0;
+    }
+  }
+
+  float get_braking_distance() {
+    fixed_t distance;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      distance = braking_distance();
+    }
+    return from_fixed(distance);
+  }
+
+  float position() {
+    fixed_t pos;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      pos = m_position;
+    }
+    return from_fixed(pos);
+  }
+
+  float speed() {
+    int32_t speed;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      speed = m_speed;
+    }
+    return speed * (1.0f / TICK_SPEED);
+  }
+
+  float increment() {
+    int32_t speed;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      speed = m_speed;
+    }
+    return speed * (1.0f / 16777216.0f);
+  }
+
+  float acceleration() {
+    return m_acceleration;
+  }
+
+  float deceleration() {
+    return m_deceleration;
+  }
+
+  void set_speed(float speed) {
+    int32_t tick_speed = to_tick_speed(speed);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      m_speed = tick_speed;
+    }
+  }
+  void set_target_speed(float speed) {
+    int32_t tick_speed = to_tick_speed(speed);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      m_target_speed = tick_speed;
+    }
+  }
+
+  // normally only used to alter position for forward error correction
+  void adjust_position(float adjustment) {
+    fixed_t change = to_fixed(adjustment);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { m_position += change; }
+  }
+
+  void set_position(float position) {
+    fixed_t pos = to_fixed(position);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { m_position = pos; }
+  }
+
+  /***
+   * For the motor controllers in systick only. These are the distance
+   * moved this tick, as Q16.16, and the speed as Q8.24 units per tick.
+   */
+  fixed_t fixed_increment() { return (m_speed + 128) >> 8; }
+  int32_t tick_speed() { return m_speed; }
+
+  // update is called from within systick and should be safe from interrupts
+  void update() {
+    if (m_state == CS_IDLE) {
+      return;
+    }
+    if (m_playback) {
+      update_playback();
+      return;
+    }
+    fixed_t remaining = fixed_abs(m_final_position) - fixed_abs(m_position);
+    if (m_state == CS_ACCELERATING) {
+      if (remaining < braking_distance()) {
+        m_state = CS_BRAKING;
+        if (m_final_speed == 0) {
+          m_target_speed = m_sign * CREEP_SPEED;
+        } else {
+          m_target_speed = m_final_speed;
+        };
+        if (!m_ramp_up) {
+          m_brake_step = braking_step(remaining);
+        }
+      }
+    }
+    // try to reach the target speed
+    if (m_ramp_up) {
+      update_s_curve_speed();
+    } else {
+      int32_t gap = m_target_speed - m_speed;
+      int32_t delta_v = m_dec_step;
+      if ((m_sign > 0) == (gap > 0)) {
+        delta_v = m_acc_step;
+      } else if (m_state == CS_BRAKING) {
+        delta_v = m_brake_step;
+      }
+      if (m_speed < m_target_speed) {
+        m_speed += delta_v;
+        if (m_speed > m_target_speed) {
+          m_speed = m_target_speed;
+        }
+      }
+      if (m_speed > m_target_speed) {
+        m_speed -= delta_v;
+        if (m_speed < m_target_speed) {
+          m_speed = m_target_speed;
+        }
+      }
+    }
+    // increment the position
+    fixed_t step = fixed_increment();
+    m_position += step;
+    // finish on the tick that ends nearest the end so that a following move starts in the right place
+    step = fixed_abs(step);
+    if (m_state != CS_FINISHED && remaining - step < max(FINISH_WINDOW, step >> 1)) {
+      m_state = CS_FINISHED;
+      m_target_speed = m_final_speed;
+    }
+  }
+
+  private:
+  static int32_t to_tick_speed(float speed) {
+    return (int32_t)(speed * TICK_SPEED + (speed < 0 ? -0.5f : 0.5f));
+  }
+
+  int32_t playback_speed() {
+    int32_t speed = m_play_scale * (ramp_level(m_phase) >> 4);
+    return (m_sign > 0) ? speed : -speed;
+  }
+
+  void update_playback() {
+    if (m_play_tick < m_ramp_ticks) {
+      m_speed = playback_speed();
+      m_phase += m_phase_step;
+    } else if (m_play_tick < m_down_tick) {
+      m_speed = m_peak_speed;
+    } else {
+      m_state = CS_BRAKING;
+      m_phase -= m_phase_step;
+      m_speed = playback_speed();
+    }
+    m_play_tick++;
+    m_position += fixed_increment();
+    if (m_play_tick >= m_down_tick + m_ramp_ticks) {
+      m_playback = false;
+      m_target_speed = 0;
+      m_state = CS_FINISHED;
+    }
+  }
+
+  /***
+   * As in the float version, the speed step that ends the braking just as
+   * the distance runs out. The squares need 64 bits but this only happens
+   * once a move.
+   */
+  int32_t braking_step(fixed_t remaining) {
+    int32_t v = fixed_abs(m_speed);
+    int32_t v_end = fixed_abs(m_target_speed);
+    fixed_t distance = remaining + ((v - v_end) >> 9);
+    if (v <= v_end || distance <= 0) {
+      return m_dec_step;
+    }
+    uint64_t squares = (uint64_t)v * v - (uint64_t)v_end * v_end;
+    return (int32_t)(squares / ((uint64_t)distance << 9));
+  }
+
+  // the speed gained while an acceleration of n jerk steps is taken out
+  static int32_t ramp_speed(int16_t n, int32_t jerk) {
+    return (jerk * ((int32_t)n * n)) >> 1;
+  }
+
+  /***
+   * The same sums as the float version, in ticks. Speeds are cut down to
+   * Q.12 before they are squared. The square root needed when braking
+   * never reaches the full deceleration is found a bit at a time as a
+   * fraction of the full ramp time.
+   */
+  fixed_t braking_distance() {
+    int32_t v = fixed_abs(m_speed);
+    int32_t v_final = fixed_abs(m_final_speed);
+    fixed_t distance = 0;
+    if (m_ramp > 0) {
+      int32_t v_extra = ramp_speed(m_ramp, m_jerk_up);
+      distance = ((v + (v_extra >> 8) * 171) >> 8) * m_ramp; // 171/256 is near 2/3
+      v += v_extra;
+    }
+    int32_t dv = fixed_abs(v - v_final);
+    if (m_ramp_down && dv < m_dec_step * m_ramp_down) {
+      uint32_t fraction = ((dv >> 8) * m_short_brake_k) >> 14; // Q.16 of the full ramp
+      uint8_t root = 0;
+      for (uint8_t bit = 0x80; bit; bit >>= 1) {
+        uint8_t trial = root | bit;
+        if ((uint16_t)trial * trial <= fraction) {
+          root = trial;
+        }
+      }
+      return distance + ((((v + v_final) >> 8) * root) >> 8) * m_ramp_down;
+    }
+    int32_t a = v >> 12;
+    int32_t b = v_final >> 12;
+    uint32_t d = (uint32_t)fixed_abs(a * a - b * b) >> 14;
+    if (d > m_brake_limit) {
+      return INT32_MAX;
+    }
+    distance += d * m_brake_k;
+    if (m_ramp_down) {
+      // the time lost to the jerk limit
+      distance += (((v + v_final) >> 8) * m_ramp_down) >> 1;
+    }
+    return distance;
+  }
+
+  void update_s_curve_speed() {
+    int32_t gap = m_target_speed - m_speed;
+    if (m_sign < 0) {
+      gap = -gap;
+    }
+    int16_t goal = 0;
+    if (gap > 0) {
+      goal = m_ramp_up;
+      if (m_ramp > 0 && gap <= ramp_speed(m_ramp, m_jerk_up)) {
+        goal = 0;
+      }
+    } else if (gap < 0) {
+      goal = -m_ramp_down;
+      if (m_ramp < 0 && -gap <= ramp_speed(-m_ramp, m_jerk_down)) {
+        goal = 0;
+      }
+    }
+    if (m_ramp < goal) {
+      m_ramp++;
+    } else if (m_ramp > goal) {
+      m_ramp--;
+    }
+    int32_t delta_v = (m_ramp > 0) ? m_ramp * m_jerk_up : m_ramp * m_jerk_down;
+    if ((gap > 0 && delta_v >= gap) || (gap < 0 && delta_v <= gap) || gap == 0) {
+      m_speed = m_target_speed;
+      m_ramp = 0;
+    } else {
+      m_speed += (m_sign > 0) ? delta_v : -delta_v;
+    }
+  }
+
+  volatile uint8_t m_state = CS_IDLE;
+  volatile int32_t m_speed = 0;
+  volatile fixed_t m_position = 0;
+  int8_t m_sign = 1;
+  int16_t m_ramp = 0; // the current S-curve acceleration in jerk steps
+  uint16_t m_ramp_up = 0;
+  uint16_t m_ramp_down = 0;
+  int32_t m_acc_step = 0;
+  int32_t m_dec_step = 0;
+  int32_t m_brake_step = 0;
+  int32_t m_jerk_up = 0;
+  int32_t m_jerk_down = 0;
+  uint32_t m_brake_k = 1;
+  uint32_t m_brake_limit = INT32_MAX;
+  uint32_t m_short_brake_k = 0;
+  int32_t m_target_speed = 0;
+  int32_t m_final_speed = 0;
+  fixed_t m_final_position = 0;
+  float m_acceleration = 0;
+  float m_deceleration = 0;
+  float m_jerk = 0;
+  bool m_playback = false;
+  uint16_t m_ramp_ticks = 0;
+  uint16_t m_down_tick = 0;
+  uint16_t m_play_tick = 0;
+  uint32_t m_phase = 0;
+  uint32_t m_phase_step = 0;
+  int32_t m_peak_speed = 0;
+  int32_t m_play_scale = 0; // the top speed as Q.12
+};
+
+#endif
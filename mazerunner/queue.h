@@ -26,60 +26,102 @@
 #ifndef QUEUE_H
 #define QUEUE_H
 
+#include <stdint.h>
+
 /**
  * The Queue class is used to speed up flooding of the maze
+ *
+ * It is a simple ring buffer with a fixed capacity that is set at compile
+ * time. There is no dynamic allocation so a queue can be declared as a
+ * local variable or a static without any risk of fragmenting the heap.
+ *
+ * The capacity must be a power of two so that the head and tail indices
+ * can be wrapped with a mask rather than a comparison.
+ *
+ * The queue keeps track of the largest number of items it has held. That
+ * high-water mark is useful to check that the capacity is sensible. It
+ * also counts every item added so that the work done can be measured.
+ *
+ * Adding to a full queue does nothing except set the overflow flag. The
+ * caller must either choose a capacity that makes that impossible or
+ * check the flag and deal with the items that were left out.
  */
-template <class item_t>
+template <class item_t, int CAPACITY>
 class Queue {
+  static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "Queue capacity must be a power of two");
+
   public:
-  explicit Queue(int maxSize = 64) : MAX_ITEMS(maxSize) {
-    mData = new item_t[MAX_ITEMS + 1];
+  Queue() {
     clear();
   }
 
-  ~Queue() {
-    delete[] mData;
-  };
-
   int size() {
     return mItemCount;
   }
 
+  int capacity() {
+    return CAPACITY;
+  }
+
   void clear() {
     mHead = 0;
     mTail = 0;
     mItemCount = 0;
+    mHighWater = 0;
+    mAdded = 0;
+    mOverflow = false;
   }
 
   void add(item_t item) {
+    if (mItemCount >= CAPACITY) {
+      mOverflow = true;
+      return;
+    }
     mData[mTail] = item;
-    ++mTail;
+    mTail = (mTail + 1) & MASK;
     ++mItemCount;
-    if (mTail > MAX_ITEMS) {
-      mTail -= MAX_ITEMS;
+    ++mAdded;
+    if (mItemCount > mHighWater) {
+      mHighWater = mItemCount;
     }
   }
 
   item_t head() {
     item_t result = mData[mHead];
-    ++mHead;
-    if (mHead > MAX_ITEMS) {
-      mHead -= MAX_ITEMS;
-    }
+    mHead = (mHead + 1) & MASK;
     --mItemCount;
     return result;
   }
 
+  int high_water() {
+    return mHighWater;
+  }
+
+  uint16_t added() {
+    return mAdded;
+  }
+
+  bool overflowed() {
+    return mOverflow;
+  }
+
+  void clear_overflow() {
+    mOverflow = false;
+  }
+
   protected:
-  item_t *mData;
-  const int MAX_ITEMS;
-  int mHead;
-  int mTail;
-  int mItemCount;
+  static const uint16_t MASK = CAPACITY - 1;
+  item_t mData[CAPACITY];
+  uint16_t mHead;
+  uint16_t mTail;
+  uint16_t mItemCount;
+  uint16_t mHighWater;
+  uint16_t mAdded;
+  bool mOverflow;
 
   private:
   // while this is probably correct, prevent use of the copy constructor
-  Queue(const Queue<item_t> &rhs) {}
+  Queue(const Queue<item_t, CAPACITY> &rhs) {}
 };
 
 #endif // QUEUE_H
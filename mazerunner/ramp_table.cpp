@@ -0,0 +1,14 @@
+// Written by tools/ramp_table.py --shape sine --bits 6. Do not edit.
+#include "ramp_table.h"
+
+const uint16_t ramp_table[65] PROGMEM = {
+        0,    39,   158,   355,   630,   982,  1411,  1915,
+     2494,  3146,  3869,  4662,  5522,  6448,  7438,  8488,
+     9597, 10762, 11980, 13248, 14563, 15922, 17321, 18758,
+    20228, 21728, 23256, 24806, 26375, 27960, 29556, 31160,
+    32767, 34375, 35979, 37575, 39160, 40729, 42279, 43807,
+    45307, 46777, 48214, 49613, 50972, 52287, 53555, 54773,
+    55938, 57047, 58097, 59087, 60013, 60873, 61666, 62389,
+    63041, 63620, 64124, 64553, 64905, 65180, 65377, 65496,
+    65535,
+};
@@ -0,0 +1,17 @@
+// Written by tools/ramp_table.py --shape sine --bits 6. Do not edit.
+#ifndef RAMP_TABLE_H
+#define RAMP_TABLE_H
+
+#include <Arduino.h>
+
+#define RAMP_TABLE_BITS 6
+
+// the rotation speed as a fraction of 65535 at each step of the ramp
+extern const uint16_t ramp_table[65] PROGMEM;
+
+// the shift and set back of an arc entered along this ramp. See turns.cpp
+constexpr float RAMP_SHIFT_2 = 0.02367882;
+constexpr float RAMP_SHIFT_4 = 0.00013607;
+constexpr float RAMP_SET_BACK_3 = 0.00183561;
+
+#endif
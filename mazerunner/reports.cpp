@@ -270,6 +270,39 @@ void report_wall_sensors() {
   Serial.print(' ');
 }
 
+//***************************************************************************//
+/***
+ * Before main() runs, all the free RAM between the variables and the top
+ * of the stack is painted with a known value. The stack wipes out the
+ * paint as it grows so the paint that is left shows the least free RAM
+ * there has been since the reset. The Q command reports it. This only
+ * works on the AVR. Anywhere else the headroom is reported as -1.
+ */
+#if defined(__AVR__)
+extern uint8_t __heap_start;
+extern uint8_t __stack;
+const uint8_t STACK_PAINT = 0xC5;
+
+void paint_stack() __attribute__((naked, used, section(".init3")));
+void paint_stack() {
+  for (uint8_t *p = &__heap_start; p <= &__stack; p++) {
+    *p = STACK_PAINT;
+  }
+}
+
+int stack_headroom() {
+  int count = 0;
+  for (const uint8_t *p = &__heap_start; p <= &__stack && *p == STACK_PAINT; p++) {
+    count++;
+  }
+  return count;
+}
+#else
+int stack_headroom() {
+  return -1;
+}
+#endif
+
 //***************************************************************************//
 
 // simple formatting functions for printing maze costs
@@ -280,8 +313,8 @@ void print_hex_2(unsigned char value) {
   Serial.print(value, HEX);
 }
 
-void print_justified(int value, int width) {
-  int v = value;
+void print_justified(long value, int width) {
+  long v = value;
   int w = width;
   w--;
   if (v < 0) {
@@ -304,7 +337,7 @@ void print_justified(int value, int width) {
 
 void printNorthWalls(int row) {
   for (int col = 0; col < MAZE_WIDTH; col++) {
-    unsigned char cell = row + MAZE_WIDTH * col;
+    cell_t cell = row + MAZE_WIDTH * col;
     Serial.print('o');
     if (is_wall(cell, NORTH)) {
       Serial.print(("---"));
@@ -317,7 +350,7 @@ void printNorthWalls(int row) {
 
 void printSouthWalls(int row) {
   for (int col = 0; col < MAZE_WIDTH; col++) {
-    unsigned char cell = row + MAZE_WIDTH * col;
+    cell_t cell = row + MAZE_WIDTH * col;
     Serial.print('o');
     if (is_wall(cell, SOUTH)) {
       Serial.print(("---"));
@@ -333,7 +366,7 @@ void print_maze_plain() {
   for (int row = MAZE_WIDTH - 1; row >= 0; row--) {
     printNorthWalls(row);
     for (int col = 0; col < MAZE_WIDTH; col++) {
-      unsigned char cell = static_cast<unsigned char>(row + MAZE_WIDTH * col);
+      cell_t cell = static_cast<cell_t>(row + MAZE_WIDTH * col);
       if (is_exit(cell, WEST)) {
         Serial.print(("    "));
       } else {
@@ -353,13 +386,17 @@ void print_maze_with_costs() {
   for (int row = MAZE_WIDTH - 1; row >= 0; row--) {
     printNorthWalls(row);
     for (int col = 0; col < MAZE_WIDTH; col++) {
-      unsigned char cell = static_cast<unsigned char>(row + MAZE_WIDTH * col);
+      cell_t cell = static_cast<cell_t>(row + MAZE_WIDTH * col);
       if (is_exit(cell, WEST)) {
         Serial.print(' ');
       } else {
         Serial.print('|');
       }
-      print_justified(cost[cell], 3);
+      if (cost[cell] == MAX_COST) {
+        Serial.print(F("  -"));
+      } else {
+        print_justified(cost[cell], 3);
+      }
     }
     Serial.println('|');
   }
@@ -376,14 +413,14 @@ void print_maze_with_directions() {
   for (int row = MAZE_WIDTH - 1; row >= 0; row--) {
     printNorthWalls(row);
     for (int col = 0; col < MAZE_WIDTH; col++) {
-      unsigned char cell = row + MAZE_WIDTH * col;
+      cell_t cell = row + MAZE_WIDTH * col;
       if (is_wall(cell, WEST)) {
         Serial.print('|');
       } else {
         Serial.print(' ');
       }
       unsigned char direction = direction_to_smallest(cell, NORTH);
-      if (cell == maze_goal()) {
+      if (is_goal(cell)) {
         direction = 4;
       }
       Serial.print(' ');
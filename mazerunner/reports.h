@@ -94,8 +94,11 @@ void report_encoder_header();
  */
 void report_pose();
 
+// the least free RAM there has been since the reset, in bytes
+int stack_headroom();
+
 void print_hex_2(unsigned char value);
-void print_justified(int value, int width);
+void print_justified(long value, int width);
 void print_maze_plain();
 void print_maze_with_costs();
 void print_maze_with_directions();
@@ -41,6 +41,11 @@
 
 volatile float g_battery_voltage;
 volatile float g_battery_scale;
+#if FIXED_POINT_CONTROL
+volatile uint16_t g_battery_scale_fixed;
+// 255/volts as Q8.8 is this divided by the ADC reading
+const uint32_t BATTERY_SCALE_DIVIDEND = (uint32_t)(255.0 * 256.0 / BATTERY_MULTIPLIER);
+#endif
 
 /*** wall sensor variables ***/
 volatile int g_front_wall_sensor;
@@ -168,7 +173,11 @@ void disable_sensors() {
 
 void update_battery_voltage() {
   g_battery_voltage = BATTERY_MULTIPLIER * battery_adc_reading;
+#if FIXED_POINT_CONTROL
+  g_battery_scale_fixed = BATTERY_SCALE_DIVIDEND / max(battery_adc_reading, 1);
+#else
   g_battery_scale = 255.0 / g_battery_voltage;
+#endif
 }
 /*********************************** Wall tracking **************************/
 /***
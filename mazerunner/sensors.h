@@ -33,11 +33,15 @@
 #ifndef SENSORS_H
 #define SENSORS_H
 
+#include "config.h"
 #include <Arduino.h>
 #include <util/atomic.h>
 //***************************************************************************//
 extern volatile float g_battery_voltage;
 extern volatile float g_battery_scale; // adjusts PWM for voltage changes
+#if FIXED_POINT_CONTROL
+extern volatile uint16_t g_battery_scale_fixed; // the same as Q8.8
+#endif
 //***************************************************************************//
 
 /*** wall sensor variables ***/
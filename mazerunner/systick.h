@@ -33,6 +33,11 @@
 #ifndef SYSTICK_H
 #define SYSTICK_H
 
+#include <stdint.h>
+
+// timer counts, of 8us each, that the last systick took. 250 is the whole tick
+extern volatile uint8_t g_systick_counts;
+
 void setup_systick();
 
 #endif
\ No newline at end of file
@@ -31,13 +31,19 @@
  */
 
 #include "tests.h"
+#include "diagonal.h"
+#include "dstar.h"
 #include "encoders.h"
+#include "maze.h"
+#include "maze_check.h"
 #include "motion.h"
 #include "motors.h"
 #include "mouse.h"
 #include "profile.h"
 #include "reports.h"
 #include "sensors.h"
+#include "stopwatch.h"
+#include "systick.h"
 
 //***************************************************************************//
 
@@ -299,7 +305,7 @@ void test_stop_at() {
     report_profile();
   }
   float remaining = final_position - forward.position();
-  forward.start(remaining, forward.speed(), 0, forward.acceleration());
+  forward.start(remaining, forward.speed(), 0, forward.acceleration(), forward.deceleration());
   while (not forward.is_finished()) {
     report_profile();
   }
@@ -519,6 +525,844 @@ void test_edge_detection() {
   disable_sensors();
   delay(100);
 }
+//***************************************************************************//
+// The flood tests all use the 16x16 sample mazes
+#if MAZE_WIDTH == 16
+/**
+ * Copy the real walls for a cell from one of the sample mazes in flash into
+ * the working map, just as the robot would when it enters the cell.
+ */
+static void reveal_walls(const uint8_t *maze, cell_t cell) {
+  uint8_t actual = pgm_read_byte_near(maze + cell);
+  for (uint8_t direction = 0; direction < 4; direction++) {
+    if (actual & (1 << direction)) {
+      set_wall_present(cell, direction);
+    }
+  }
+  mark_cell_visited(cell);
+}
+
+/**
+ * Cell counting costs always fit in a byte so copies of the cost array
+ * for comparison are kept that way to save stack space. Unreachable
+ * cells are held as 255.
+ */
+static void save_costs(uint8_t *copy) {
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    copy[i] = cost[i] > 255 ? 255 : cost[i];
+  }
+}
+
+static void restore_costs(const uint8_t *copy) {
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    cost[i] = copy[i] == 255 ? MAX_COST : copy[i];
+  }
+}
+
+static int count_cost_errors(const uint8_t *copy) {
+  int errors = 0;
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    if (copy[i] != (cost[i] > 255 ? 255 : cost[i])) {
+      errors++;
+    }
+  }
+  return errors;
+}
+
+/** TEST 22
+ *
+ * The robot does not move for this test. Instead, it simulates a search of
+ * the japan2007 maze to the goal and back again. At every cell, the walls
+ * are revealed from the stored maze and the costs are updated with the
+ * incremental flood. The result is checked, cell by cell, against a full
+ * flood of the same map.
+ *
+ * The search is done twice. The second time, the maze is pruned at every
+ * cell before the update, just as search_to() does, so that the repair is
+ * checked against the pruned full flood. The incremental time then
+ * includes the pruning.
+ *
+ * Each report gives the number of cells visited, the number of cells where
+ * the two floods disagree (should always be zero), the number of updates
+ * that were repairs rather than full floods and the mean and worst case
+ * times for each kind of flood in microseconds.
+ *
+ * NOTE: the current maze map is lost.
+ *
+ * @brief compare the incremental flood with a full flood during a search
+ */
+void test_incremental_flood() {
+  uint8_t saved[MAZE_CELLS];
+  cell_t targets[] = {maze_goal(), START};
+  for (int pruning = 0; pruning < 2; pruning++) {
+    uint32_t full_total = 0;
+    uint32_t full_max = 0;
+    uint32_t update_total = 0;
+    uint32_t update_max = 0;
+    int cells = 0;
+    int errors = 0;
+    cell_t location = START;
+    uint8_t heading = NORTH;
+    initialise_maze(emptyMaze);
+    uint16_t repairs = flood_repair_count();
+    for (int leg = 0; leg < 2; leg++) {
+      cell_t target = targets[leg];
+      flood_maze(target);
+      while (!is_target(location, target)) {
+        reveal_walls(japan2007, location);
+        Stopwatch stopwatch;
+        if (pruning) {
+          prune_maze(target, location);
+        }
+        update_flood(target);
+        stopwatch.stop();
+        uint32_t update_time = stopwatch.elapsed_time();
+        save_costs(saved);
+        stopwatch.start();
+        flood_maze(target);
+        stopwatch.stop();
+        uint32_t full_time = stopwatch.elapsed_time();
+        errors += count_cost_errors(saved);
+        // carry on from the incremental result so that any errors accumulate
+        restore_costs(saved);
+        update_total += update_time;
+        update_max = max(update_max, update_time);
+        full_total += full_time;
+        full_max = max(full_max, full_time);
+        cells++;
+        heading = direction_to_smallest(location, heading);
+        location = neighbour(location, heading);
+      }
+    }
+    repairs = flood_repair_count() - repairs;
+    if (pruning) {
+      Serial.println(F("pruned search"));
+    } else {
+      Serial.println(F("plain search"));
+    }
+    Serial.print(F("cells: "));
+    Serial.print(cells);
+    Serial.print(F("  errors: "));
+    Serial.print(errors);
+    Serial.print(F("  repairs: "));
+    Serial.println(repairs);
+    Serial.print(F("full flood  mean/max (us): "));
+    Serial.print(full_total / cells);
+    Serial.print('/');
+    Serial.println(full_max);
+    Serial.print(F("incremental mean/max (us): "));
+    Serial.print(update_total / cells);
+    Serial.print('/');
+    Serial.println(update_max);
+  }
+  clear_pruned_cells();
+}
+
+//***************************************************************************//
+/**
+ * Time one flood engine on the current maze map. The costs are left
+ * in the cost array.
+ */
+static uint32_t time_flood(void (*flood)(cell_t), cell_t target) {
+  Stopwatch stopwatch;
+  flood(target);
+  stopwatch.stop();
+  return stopwatch.elapsed_time();
+}
+
+/***
+ * The robot does not move for this test. Both flood engines are run on
+ * the empty maze and on the japan2007 maze, flooding to the goal and to the
+ * start cell. Each line of the report gives the time taken by the queue
+ * flood and by the bitboard flood, in microseconds, and the number of cells
+ * where their costs disagree (should always be zero).
+ *
+ * NOTE: the current maze map is lost.
+ *
+ * @brief compare the bitboard flood with the queue flood
+ */
+void test_flood_engines() {
+  uint8_t saved[MAZE_CELLS];
+  const uint8_t *mazes[] = {emptyMaze, japan2007};
+  cell_t targets[] = {maze_goal(), START};
+  Serial.println(F("maze target  queue  bitboard  errors"));
+  for (int m = 0; m < 2; m++) {
+    initialise_maze(mazes[m]);
+    for (int t = 0; t < 2; t++) {
+      uint32_t queue_time = time_flood(flood_maze_queue, targets[t]);
+      save_costs(saved);
+      uint32_t bitboard_time = time_flood(flood_maze_bitboard, targets[t]);
+      int errors = count_cost_errors(saved);
+      Serial.print(m);
+      Serial.print(F("    "));
+      print_hex_2(targets[t]);
+      Serial.print(F("      "));
+      Serial.print(queue_time);
+      Serial.print(F("  "));
+      Serial.print(bitboard_time);
+      Serial.print(F("  "));
+      Serial.println(errors);
+    }
+  }
+}
+
+#if DSTAR_PLANNER
+/**
+ * Simulate a search of japan2007 to the goal and back, revealing the walls
+ * of each cell as it is entered. Returns the total time spent planning
+ * in microseconds and the number of cells moved through the count.
+ */
+static uint32_t simulate_search(bool use_dstar, int *moves) {
+  uint32_t total = 0;
+  cell_t location = START;
+  uint8_t heading = NORTH;
+  cell_t targets[] = {maze_goal(), START};
+  initialise_maze(emptyMaze);
+  for (int leg = 0; leg < 2; leg++) {
+    cell_t target = targets[leg];
+    Stopwatch stopwatch;
+    if (use_dstar) {
+      dstar_begin(target, location);
+    } else {
+      flood_maze(target);
+    }
+    total += stopwatch.split();
+    while (!is_target(location, target)) {
+      reveal_walls(japan2007, location);
+      stopwatch.start();
+      if (use_dstar) {
+        dstar_move_to(location);
+        heading = dstar_direction(heading);
+      } else {
+        update_flood(target);
+        heading = direction_to_smallest(location, heading);
+      }
+      total += stopwatch.split();
+      location = neighbour(location, heading);
+      (*moves)++;
+    }
+    dstar_end();
+  }
+  return total;
+}
+
+/** TEST 25
+ *
+ * The robot does not move for this test. The same simulated search of
+ * japan2007 is planned first with the incremental flood and then with
+ * the D* Lite planner. The report gives the cells moved through, the
+ * total planning time in microseconds and the number of cells each
+ * planner worked on. Both should move through the same number of cells.
+ *
+ * NOTE: the current maze map is lost.
+ *
+ * @brief compare the D* Lite planner with the flood during a search
+ */
+void test_dstar_planner() {
+  int flood_moves = 0;
+  int dstar_moves = 0;
+  uint32_t pushes = flood_queue_pushes();
+  uint32_t flood_time = simulate_search(false, &flood_moves);
+  pushes = flood_queue_pushes() - pushes;
+  uint32_t expansions = dstar_expansions();
+  uint32_t dstar_time = simulate_search(true, &dstar_moves);
+  expansions = dstar_expansions() - expansions;
+  Serial.println(F("planner  moves   time  cells"));
+  Serial.print(F("flood "));
+  print_justified(flood_moves, 8);
+  print_justified(flood_time, 7);
+  print_justified(pushes, 7);
+  Serial.println();
+  Serial.print(F("dstar "));
+  print_justified(dstar_moves, 8);
+  print_justified(dstar_time, 7);
+  print_justified(expansions, 7);
+  Serial.println();
+}
+#endif
+#endif
+
+#if MAZE_WIDTH == 16
+//***************************************************************************//
+static const char japan_path[] PROGMEM =
+    "BFFFRLLRRLLRRLLRFFRRFLLFFLRFRRLLRRLLRFFFFFFFFFRFFFFFRLRLLRRLLRRFFRFFFLFFS";
+
+static int s_letter;
+static bool s_letters_match;
+
+static void expect_letter(char c) {
+  char expected = pgm_read_byte(japan_path + s_letter);
+  if (expected != c) {
+    s_letters_match = false;
+  }
+  if (expected) {
+    s_letter++;
+  }
+}
+
+/***
+ * Turn the diagonal path back into one letter for each cell, the same as
+ * print_path() would, and compare it with the expected path. Every cell
+ * crossed corner to corner is a turn. Along a diagonal the turns
+ * alternate unless a DD90 makes two the same way.
+ */
+static bool diagonal_path_matches(const move_t *path) {
+  s_letter = 0;
+  s_letters_match = true;
+  expect_letter('B');
+  uint8_t owed = 0;
+  char next = 'R';
+  for (int i = 0; path[i] != MOVE_STOP; i++) {
+    move_t move = path[i];
+    char side = (move & 1) ? 'R' : 'L';
+    if (move & MOVE_FORWARD) {
+      for (uint8_t h = move & MAX_STRAIGHT; h > 0; h--) {
+        if (owed > 0) {
+          owed--;
+        } else {
+          expect_letter('F');
+          owed = 1;
+        }
+      }
+      continue;
+    }
+    owed = 1;
+    if (move & MOVE_DIAGONAL) {
+      for (uint8_t h = move & MAX_DIAGONAL; h > 0; h--) {
+        expect_letter(next);
+        next = (next == 'R') ? 'L' : 'R';
+      }
+      continue;
+    }
+    switch (move) {
+      case MOVE_SS180R:
+      case MOVE_SS180L:
+        expect_letter(side);
+        // fall through
+      case MOVE_RIGHT:
+      case MOVE_LEFT:
+      case MOVE_DS135R:
+      case MOVE_DS135L:
+        expect_letter(side);
+        break;
+      case MOVE_SD135R:
+      case MOVE_SD135L:
+        expect_letter(side);
+        // fall through
+      case MOVE_SD45R:
+      case MOVE_SD45L:
+      case MOVE_DD90R:
+      case MOVE_DD90L:
+        next = side;
+        break;
+      default:
+        break;
+    }
+  }
+  expect_letter('S');
+  return s_letters_match && pgm_read_byte(japan_path + s_letter) == 0;
+}
+
+/** TEST 26
+ *
+ * The robot does not move for this test. The japan2007 maze is flooded
+ * and the path from the start is made and compiled into a diagonal path.
+ * Both are printed. The diagonal path is then checked in two ways:
+ *
+ *   - turned back into one letter for each cell, it must give the
+ *     expected path string for japan2007.
+ *   - the total change of heading and the number of cells turned in,
+ *     from the turn table, must agree with the expected path string.
+ *
+ * NOTE: the current maze map is lost.
+ *
+ * @brief check the diagonal path compiler on the japan2007 path
+ */
+void test_diagonal_path() {
+  initialise_maze(japan2007);
+  flood_maze(maze_goal());
+  dorothy.make_path(START);
+  dorothy.print_path();
+  move_t path[MOVE_LIST_LENGTH];
+  bool compiled = compile_diagonal_path(path);
+  print_diagonal_path(path);
+
+  int expected_angle = 0;
+  int expected_cells = 0;
+  for (int i = 0; char c = pgm_read_byte(japan_path + i); i++) {
+    if (c == 'R' || c == 'L') {
+      expected_angle += (c == 'R') ? 2 : -2;
+      expected_cells++;
+    }
+  }
+  int angle = 0;
+  int cells = 0;
+  for (int i = 0; path[i] != MOVE_STOP; i++) {
+    move_t move = path[i];
+    if (move & MOVE_FORWARD) {
+      continue;
+    }
+    if (move & MOVE_DIAGONAL) {
+      cells += move & MAX_DIAGONAL;
+      continue;
+    }
+    angle += turn_angle(move);
+    cells += turn_cells(move);
+  }
+  bool ok = compiled && diagonal_path_matches(path) && angle == expected_angle && cells == expected_cells;
+  Serial.println(ok ? F("OK") : F("FAIL"));
+}
+#endif
+
+//***************************************************************************//
+static bool report_check(const __FlashStringHelper *name, bool pass) {
+  Serial.print(name);
+  Serial.println(pass ? F(" OK") : F(" FAIL"));
+  return pass;
+}
+
+#if MAZE_WIDTH == 16
+// an inside cell of japan2007 with a north wall
+static cell_t walled_cell() {
+  for (cell_t cell = MAZE_WIDTH + 1; cell < MAZE_CELLS - MAZE_WIDTH; cell++) {
+    if ((cell % MAZE_WIDTH) < MAZE_WIDTH - 1 && is_wall(cell, NORTH)) {
+      return cell;
+    }
+  }
+  return START;
+}
+
+/** TEST 27
+ *
+ * The robot does not move for this test. The maze checker is given the
+ * japan2007 maze, which should pass, and then the same maze with one
+ * fault at a time. Each fault should be found and, where possible,
+ * repaired. Last, a wall is seen several times, sometimes present and
+ * sometimes not. A single misread after the first sighting must not
+ * change the map. After that the map should follow the majority.
+ *
+ * NOTE: the current maze map is lost.
+ *
+ * @brief check the maze checker finds and repairs impossible walls
+ */
+void test_maze_check() {
+  bool ok = true;
+  initialise_maze(japan2007);
+  cell_t cell = walled_cell();
+  cell_t above = neighbour(cell, NORTH);
+  maze_check_begin();
+  ok &= report_check(F("japan2007     "), maze_check_all() == 0);
+
+  walls[above] &= ~(1 << SOUTH);
+  ok &= report_check(F("one sided     "), maze_check_cell(cell) == MAP_ONE_SIDED && is_wall(above, SOUTH));
+
+  walls[START + 2] &= ~(1 << WEST);
+  ok &= report_check(F("boundary      "), maze_check_cell(START + 2) == MAP_NO_BOUNDARY && is_wall(START + 2, WEST));
+
+  for (uint8_t direction = 0; direction < 4; direction++) {
+    set_wall_present(cell, direction);
+  }
+  ok &= report_check(F("walled in     "), (maze_check_all() & (MAP_ISOLATED | MAP_ONE_SIDED)) == MAP_ISOLATED);
+
+  initialise_maze(japan2007);
+  for (uint8_t i = 0; i < maze_goal_count(); i++) {
+    for (uint8_t direction = 0; direction < 4; direction++) {
+      if (!is_goal(neighbour(maze_goal_cell(i), direction))) {
+        set_wall_present(maze_goal_cell(i), direction);
+      }
+    }
+  }
+  ok &= report_check(F("closed goal   "), maze_check_all() == (MAP_GOAL_CLOSED | MAP_NO_ROUTE));
+
+  initialise_maze(japan2007);
+  walls[cell] &= ~VISITED;
+  walls[above] &= ~VISITED;
+  maze_check_begin();
+  maze_check_observe(cell, NORTH, true); // the first sighting
+  mark_cell_visited(cell);
+  maze_check_observe(cell, NORTH, false); // one misread
+  bool misread = is_wall(cell, NORTH) && maze_check_conflicts() == 1 && maze_check_repairs() == 0;
+  ok &= report_check(F("one misread   "), misread);
+
+  maze_check_observe(cell, NORTH, false); // a second one takes it out
+  bool votes = !is_wall(cell, NORTH);
+  maze_check_observe(cell, NORTH, true);
+  maze_check_observe(cell, NORTH, true);
+  maze_check_observe(cell, NORTH, false); // outvoted
+  votes = votes && is_wall(cell, NORTH) && is_wall(above, SOUTH);
+  votes = votes && maze_check_conflicts() == 4 && maze_check_repairs() == 2;
+  ok &= report_check(F("majority vote "), votes);
+  Serial.println(ok ? F("OK") : F("FAIL"));
+}
+
+/**
+ * One simulated search leg of japan2007, revealing the walls of each cell
+ * as it is entered. Stops at the target, when the target is walled off or
+ * after too many moves. Returns true if the leg ended at its target.
+ */
+static bool simulate_leg(cell_t &location, uint8_t &heading, cell_t target, int *moves) {
+  flood_maze(target);
+  for (int i = 0; i < MAZE_CELLS && !is_target(location, target); i++) {
+    reveal_walls(japan2007, location);
+    update_flood(target);
+    if (cost[location] == MAX_COST) {
+      return false;
+    }
+    heading = direction_to_smallest(location, heading);
+    location = neighbour(location, heading);
+    (*moves)++;
+  }
+  reveal_walls(japan2007, location);
+  return is_target(location, target);
+}
+
+/** TEST 31
+ *
+ * The robot does not move for this test. The mouse is put in one goal
+ * cell of an unknown japan2007 and sent to another, with the exact
+ * targets that explore_until_solved() uses. It must get to that cell and
+ * not stop at once because it is already in the goal area. Then a search
+ * to the goal is simulated and exploration carries on from inside the
+ * goal area, one leg at a time, until the maze is solved. Every leg must
+ * move the mouse and the exploration must end.
+ *
+ * NOTE: the current maze map is lost.
+ *
+ * @brief explore from inside the goal area
+ */
+void test_explore_from_goal() {
+  bool ok = true;
+  int moves = 0;
+  initialise_maze(emptyMaze);
+  cell_t location = maze_goal_cell(0);
+  uint8_t heading = NORTH;
+  cell_t target = maze_goal_cell(maze_goal_count() - 1);
+  set_exact_target(true);
+  bool arrived = !is_target(location, target) && simulate_leg(location, heading, target, &moves);
+  ok &= report_check(F("goal to goal  "), arrived && location == target && moves > 0);
+
+  set_exact_target(false);
+  initialise_maze(emptyMaze);
+  location = START;
+  heading = NORTH;
+  simulate_leg(location, heading, maze_goal(), &moves);
+  set_exact_target(true);
+  int legs = 0;
+  int goal_legs = 0;
+  bool moving = true;
+  while (legs < MAZE_CELLS && !maze_is_solved() && nearest_frontier_cell(location, &target)) {
+    int before = moves;
+    goal_legs += is_goal(target);
+    simulate_leg(location, heading, target, &moves);
+    moving = moving && moves > before;
+    legs++;
+  }
+  set_exact_target(false);
+  Serial.print(F("legs "));
+  Serial.print(legs);
+  Serial.print(F(" to goal cells "));
+  Serial.println(goal_legs);
+  ok &= report_check(F("every leg     "), moving);
+  ok &= report_check(F("solved        "), legs < MAZE_CELLS && maze_is_solved());
+  Serial.println(ok ? F("OK") : F("FAIL"));
+}
+#endif
+
+//***************************************************************************//
+// run a trapezoid and an S-curve with the biggest jerk that still uses the S-curve code side by side
+static bool profiles_match(float distance, float top_speed, float final_speed, float acceleration, float deceleration) {
+  Profile trapezoid;
+  Profile s_curve;
+  s_curve.set_jerk(0.9f * min(acceleration, deceleration) * LOOP_FREQUENCY);
+  trapezoid.start(distance, top_speed, final_speed, acceleration, deceleration);
+  s_curve.start(distance, top_speed, final_speed, acceleration, deceleration);
+  // the S-curve takes a few ticks to reach full acceleration so it lags a little
+  float position_error = 2 * top_speed * LOOP_INTERVAL;
+  float speed_error = 2 * max(acceleration, deceleration) * LOOP_INTERVAL;
+  for (int i = 0; i < 2000 && !(trapezoid.is_finished() && s_curve.is_finished()); i++) {
+    if (!trapezoid.is_finished()) {
+      trapezoid.update();
+    }
+    if (!s_curve.is_finished()) {
+      s_curve.update();
+    }
+    if (fabsf(trapezoid.position() - s_curve.position()) > position_error) {
+      return false;
+    }
+    if (!trapezoid.is_finished() && !s_curve.is_finished() && fabsf(trapezoid.speed() - s_curve.speed()) > speed_error) {
+      return false;
+    }
+  }
+  return trapezoid.is_finished() && s_curve.is_finished() && fabsf(s_curve.position() - distance) < 0.5;
+}
+
+// a jerk limited move to rest should come to a stop close to the end
+static bool s_curve_stops(float distance, float top_speed, float acceleration, float deceleration, float jerk) {
+  Profile s_curve;
+  s_curve.set_jerk(jerk);
+  s_curve.start(distance, top_speed, 0, acceleration, deceleration);
+  for (int i = 0; i < 2000 && !(s_curve.is_finished() && s_curve.speed() == 0); i++) {
+    s_curve.update();
+  }
+  return s_curve.is_finished() && fabsf(s_curve.position() - distance) < 0.5;
+}
+
+// a trapezoid should finish on time, with no creeping up to the end
+static bool trapezoid_on_time(float distance, float top_speed, float final_speed, float acceleration) {
+  Profile trapezoid;
+  trapezoid.start(distance, top_speed, final_speed, acceleration);
+  int ticks = 0;
+  while (ticks < 2000 && !(trapezoid.is_finished() && trapezoid.speed() == final_speed)) {
+    trapezoid.update();
+    ticks++;
+  }
+  float expected = profile_time(distance, 0, top_speed, final_speed, acceleration) * LOOP_FREQUENCY;
+  return fabsf(ticks - expected) < 3;
+}
+
+// a trapezoid should hand over at the end of the move, or come to rest there
+static bool trapezoid_lands(float distance, float top_speed, float final_speed, float acceleration) {
+  Profile trapezoid;
+  trapezoid.start(distance, top_speed, final_speed, acceleration);
+  for (int i = 0; i < 2000 && !trapezoid.is_finished(); i++) {
+    trapezoid.update();
+  }
+  if (!trapezoid.is_finished()) {
+    return false;
+  }
+  if (final_speed != 0) {
+    // the last tick is the one that ends nearest the end
+    float error = 0.5f * fabsf(final_speed) * LOOP_INTERVAL;
+    return trapezoid.speed() == final_speed && fabsf(trapezoid.position() - distance) <= error;
+  }
+  // the last few ticks bring the speed down to zero without creeping
+  for (int i = 0; i < 10 && trapezoid.speed() != 0; i++) {
+    trapezoid.update();
+  }
+  return trapezoid.speed() == 0 && fabsf(trapezoid.position() - distance) < 0.05;
+}
+
+// a played back move should take whole ticks, cover the distance and come to rest
+static bool playback_on_time(float distance, float top_speed, uint16_t ramp_ticks) {
+  Profile player;
+  player.start_playback(distance, top_speed, ramp_ticks);
+  int ticks = 0;
+  while (ticks < 2000 && !player.is_finished()) {
+    player.update();
+    ticks++;
+  }
+  player.update();
+  float hold = fabsf(distance) / (top_speed * LOOP_INTERVAL) - ramp_ticks;
+  float expected = 2 * ramp_ticks + max(hold, 0.0f);
+  return fabsf(ticks - expected) <= 1 && fabsf(player.position() - distance) < 0.05 && player.speed() == 0;
+}
+
+/** TEST 28
+ *
+ * The robot does not move for this test. Two spare profiles are run
+ * side by side to check the S-curve mode. With a jerk limit just small
+ * enough for the S-curve code to be used, the S-curve must stay within
+ * two ticks of the trapezoid in position and speed, and must finish at
+ * the end of the move. With a real jerk limit, a move to rest must still
+ * stop at the right place. The trapezoid must finish in the time it says
+ * it should, including the rotations of an SS90 turn at 500mm/s and
+ * 700mm/s. A move to rest must then come to a stop at the end within a
+ * few ticks and a move at speed must hand over at its final speed within
+ * half a tick of the end. The same rotations are then
+ * played back from the ramp table. They must end on the right tick, at
+ * the right angle and at rest.
+ *
+ * @brief check the S-curve profile against the trapezoid
+ */
+void test_profile_s_curve() {
+  bool ok = true;
+  ok &= report_check(F("stop          "), profiles_match(540, 800, 0, 3000, 3000));
+  ok &= report_check(F("reverse       "), profiles_match(-540, 800, 0, 3000, 3000));
+  ok &= report_check(F("handoff       "), profiles_match(180, 800, 400, 3000, 3000));
+  ok &= report_check(F("short         "), profiles_match(20, 800, 0, 3000, 3000));
+  ok &= report_check(F("asymmetric    "), profiles_match(1000, 1200, 300, 5000, 2500));
+  ok &= report_check(F("jerk stop     "), s_curve_stops(540, 800, 3000, 3000, 20000));
+  ok &= report_check(F("jerk short    "), s_curve_stops(90, 800, 2000, 2000, 20000));
+  ok &= report_check(F("jerk asymm    "), s_curve_stops(600, 800, 4000, 2000, 50000));
+  ok &= report_check(F("on time       "), trapezoid_on_time(540, 800, 0, 3000));
+  ok &= report_check(F("SS90 at 500   "), trapezoid_on_time(90, 467, 0, 11109));
+  ok &= report_check(F("SS90 at 700   "), trapezoid_on_time(90, 653, 0, 21774));
+  ok &= report_check(F("land stop     "), trapezoid_lands(540, 800, 0, 3000));
+  ok &= report_check(F("land reverse  "), trapezoid_lands(-90, 300, 0, 4000));
+  ok &= report_check(F("land handoff  "), trapezoid_lands(180, 800, 400, 3000));
+  ok &= report_check(F("land SS90 500 "), trapezoid_lands(90, 467, 0, 11109));
+  ok &= report_check(F("land SS90 700 "), trapezoid_lands(90, 653, 0, 21774));
+  ok &= report_check(F("play SS90 500 "), playback_on_time(90, 467, 21));
+  ok &= report_check(F("play SS90 700 "), playback_on_time(90, 653, 15));
+  ok &= report_check(F("play reverse  "), playback_on_time(-90, 467, 21));
+  ok &= report_check(F("play short    "), playback_on_time(20, 467, 40));
+  Serial.println(ok ? F("OK") : F("FAIL"));
+}
+
+//***************************************************************************//
+// sample the systick time until the rotation profile finishes or time runs out
+static void report_systick_time(const __FlashStringHelper *name, uint32_t duration) {
+  uint32_t total = 0;
+  uint32_t samples = 0;
+  uint8_t longest = 0;
+  uint32_t end_time = millis() + duration;
+  while (millis() < end_time && not rotation.is_finished()) {
+    uint8_t counts = g_systick_counts;
+    total += counts;
+    samples++;
+    longest = max(longest, counts);
+  }
+  Serial.print(name);
+  Serial.print(F(" mean "));
+  Serial.print(8.0 * total / max(samples, (uint32_t)1), 0);
+  Serial.print(F("us max "));
+  Serial.print(8 * longest);
+  Serial.println(F("us of 2000us"));
+}
+
+/** TEST 29
+ *
+ * Measures how long the systick ISR takes. First with the robot at rest
+ * and the controllers holding it still, then while it turns once on the
+ * spot with both profiles running and once more with the rotation played
+ * back from the ramp table. Build it once with FIXED_POINT_CONTROL set to
+ * 0 and once set to 1 to see the difference.
+ *
+ * @brief measure the time taken by the systick ISR
+ */
+void test_systick_time() {
+  Serial.println(FIXED_POINT_CONTROL ? F("Fixed point control") : F("Float control"));
+  reset_drive_system();
+  enable_motor_controllers();
+  report_systick_time(F("at rest "), 500);
+  forward.start(0, 0, 0, 1000); // finishes at once but still runs every tick
+  rotation.start(360, 360, 0, 1800);
+  report_systick_time(F("turning "), 5000);
+  rotation.start_playback(360, 360, 250);
+  report_systick_time(F("playback"), 5000);
+  reset_drive_system();
+}
+
+//***************************************************************************//
+/** TEST 30
+ *
+ * The same moves as test 11 but queued up front. The systick ISR starts
+ * each one as the last one finishes so the logged profile should show no
+ * flat spots or speed steps where the moves join. Compare the two logs.
+ *
+ * @brief queued move, smooth turn, move sequence
+ */
+void test_queued_smooth_turn(float angle) {
+  int turn_speed = 300;
+  reset_drive_system();
+  enable_motor_controllers();
+  report_profile_header();
+  queue_forward(300, 800, turn_speed, 1500);
+  queue_rotation(angle, 300, 0, 2000);
+  queue_forward(300, 800, 0, 1000);
+  while (not motion_queue_done()) {
+    report_profile();
+  }
+  reset_drive_system();
+}
+
+//***************************************************************************//
+const int TIMING_RUNS = 100;
+
+/**
+ * Sort the run times and print the mean, 99th percentile and worst case
+ * in microseconds, the operations in each run and an estimate of the
+ * processor cycles for each operation.
+ */
+static void report_timing(const __FlashStringHelper *name, uint16_t *times, uint32_t operations) {
+  uint32_t total = 0;
+  for (int i = 0; i < TIMING_RUNS; i++) {
+    uint16_t t = times[i];
+    int j = i;
+    while (j > 0 && times[j - 1] > t) {
+      times[j] = times[j - 1];
+      j--;
+    }
+    times[j] = t;
+    total += t;
+  }
+  uint32_t mean = total / TIMING_RUNS;
+  uint32_t ops = operations / TIMING_RUNS;
+  Serial.print(name);
+  print_justified(mean, 7);
+  print_justified(times[(TIMING_RUNS * 99) / 100 - 1], 7);
+  print_justified(times[TIMING_RUNS - 1], 7);
+  print_justified(ops, 6);
+  print_justified(ops ? mean * (F_CPU / 1000000L) / ops : 0, 7);
+  Serial.println();
+}
+
+/** TEST 24
+ *
+ * The robot does not move for this test. It measures the maze functions
+ * that run while the mouse is moving. Each one is run many times on the
+ * current maze map and then on each of the sample mazes. Use the L
+ * command first to measure a maze of your choice.
+ *
+ *   flood  - flood_maze() to the goal. The operations are cells queued.
+ *   path   - make_path() from the start. The operations are moves in the list.
+ *   dir    - direction_to_smallest() for every cell. The operations are calls.
+ *
+ * Times are in microseconds with the normal interrupts running so they
+ * are a little longer than the best case. The last column is the mean
+ * number of processor cycles for each operation. The benchmark in
+ * tools/host runs the same measurements on a desktop computer.
+ *
+ * NOTE: the current maze map is lost.
+ *
+ * @brief time the flood, path generator and direction functions
+ */
+void test_maze_timing() {
+  uint16_t times[TIMING_RUNS];
+#if MAZE_WIDTH == 16
+  const uint8_t *mazes[] = {nullptr, emptyMaze, japan2007};
+#else
+  const uint8_t *mazes[] = {nullptr, emptyMaze};
+#endif
+  const int maze_count = sizeof(mazes) / sizeof(mazes[0]);
+  for (int m = 0; m < maze_count; m++) {
+    if (m > 0) {
+      initialise_maze(mazes[m]);
+    }
+    Serial.print(F("maze "));
+    Serial.println(m);
+    Serial.println(F("         mean    p99    max   ops cycles"));
+    uint32_t pushes = flood_queue_pushes();
+    for (int i = 0; i < TIMING_RUNS; i++) {
+      Stopwatch stopwatch;
+      flood_maze(maze_goal());
+      times[i] = stopwatch.split();
+    }
+    report_timing(F("flood "), times, flood_queue_pushes() - pushes);
+
+    uint32_t steps = 0;
+    for (int i = 0; i < TIMING_RUNS; i++) {
+      Stopwatch stopwatch;
+      dorothy.make_path(START);
+      times[i] = stopwatch.split();
+      for (int k = 0; moves[k] != MOVE_STOP; k++) {
+        steps++;
+      }
+    }
+    report_timing(F("path  "), times, steps);
+
+    volatile uint8_t direction = NORTH;
+    for (int i = 0; i < TIMING_RUNS; i++) {
+      Stopwatch stopwatch;
+      for (int cell = 0; cell < MAZE_CELLS; cell++) {
+        direction = direction_to_smallest(cell, direction);
+      }
+      times[i] = stopwatch.split();
+    }
+    report_timing(F("dir   "), times, (uint32_t)MAZE_CELLS * TIMING_RUNS);
+  }
+}
+
 //***************************************************************************//
 /** Test runner
  *
@@ -590,6 +1434,42 @@ void run_test(int test) {
     case (21):
       test_sensor_spin_calibrate();
       break;
+#if MAZE_WIDTH == 16
+    case (22):
+      test_incremental_flood();
+      break;
+    case (23):
+      test_flood_engines();
+      break;
+#endif
+    case (24):
+      test_maze_timing();
+      break;
+#if MAZE_WIDTH == 16 && DSTAR_PLANNER
+    case (25):
+      test_dstar_planner();
+      break;
+#endif
+#if MAZE_WIDTH == 16
+    case (26):
+      test_diagonal_path();
+      break;
+    case (27):
+      test_maze_check();
+      break;
+    case (31):
+      test_explore_from_goal();
+      break;
+#endif
+    case (28):
+      test_profile_s_curve();
+      break;
+    case (29):
+      test_systick_time();
+      break;
+    case (30):
+      test_queued_smooth_turn(90);
+      break;
     default:
       disable_sensors();
       reset_drive_system();
@@ -0,0 +1,194 @@
+/*
+ * File: turns.cpp
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+
+
+#include "turns.h"
+#include "config.h"
+#include "diagonal.h"
+#include "motion.h"
+#include "profile.h"
+#include "ramp_table.h"
+#include <Arduino.h>
+
+/***
+ * While the rotation builds up at a steady forward speed, the curvature
+ * grows in proportion to the distance. That is a clothoid. Compared with a
+ * plain arc of the same radius, the arc is pushed inwards by the shift and
+ * the turn starts earlier by the set back. These are the usual first terms
+ * of the series. They are good to well under a millimetre for any ramp
+ * shorter than the radius.
+ *
+ * A played back turn follows the shape in the ramp table instead. The
+ * tool that wrote the table worked out the same terms for that shape.
+ */
+#if TURN_PLAYBACK
+constexpr float SHIFT_2 = RAMP_SHIFT_2;
+constexpr float SHIFT_4 = RAMP_SHIFT_4;
+constexpr float SET_BACK_3 = RAMP_SET_BACK_3;
+#else
+constexpr float SHIFT_2 = 1.0f / 24;
+constexpr float SHIFT_4 = 1.0f / 2688;
+constexpr float SET_BACK_3 = 1.0f / 240;
+#endif
+
+constexpr float ramp_shift(float radius, float ramp) {
+  return SHIFT_2 * ramp * ramp / radius - SHIFT_4 * ramp * ramp * ramp * ramp / (radius * radius * radius);
+}
+
+constexpr float ramp_set_back(float radius, float ramp) {
+  return ramp / 2 - SET_BACK_3 * ramp * ramp * ramp / (radius * radius);
+}
+
+/***
+ * The distance from the start of the rotation to the point where the entry
+ * and exit straights would cross. For a U-turn they never cross so it is
+ * measured to the line through the centre of the arc instead.
+ */
+constexpr float tangent_length(float angle, float radius, float ramp) {
+  return (angle < 180 ? (radius + ramp_shift(radius, ramp)) * tan(angle * (PI / 180) / 2) : 0) + ramp_set_back(radius, ramp);
+}
+
+/***
+ * The entry and exit distances are from the reference points to the
+ * crossing point of the straights, or to the centre line of a U-turn.
+ * They depend only on the maze.
+ */
+constexpr TurnShape turn_shape(float angle, float radius, float ramp, float entry, float exit) {
+  return {angle, radius, ramp, entry - tangent_length(angle, radius, ramp), exit - tangent_length(angle, radius, ramp)};
+}
+
+// the radius of a U-turn that moves the robot across by exactly one cell
+constexpr float u_turn_radius(float ramp) {
+  return (HALF_CELL + sqrt(HALF_CELL * HALF_CELL - 4 * SHIFT_2 * ramp * ramp)) / 2;
+}
+
+constexpr float HALF_DIAGONAL = FULL_CELL * 0.70710678f;
+
+// The search turns were tuned at 300mm/s with 280deg/s and 4000deg/s/s
+constexpr float SS90_RADIUS = 61.4;
+constexpr float SS90_RAMP = 21.0;
+constexpr float SS180_RAMP = 40.0;
+
+/***
+ * Every reference point is in the middle of a cell edge. The SS90 turns
+ * cross at the cell centre. The U-turn goes round the post between its two
+ * cells. The 45 degree turns and the V90 turn cross at the reference point
+ * itself so they always cut into the straights either side.
+ */
+static constexpr TurnShape turn_shapes[MOVE_TYPES] PROGMEM = {
+    {0, 0, 0, 0, 0},                                               // STOP
+    turn_shape(90, SS90_RADIUS, SS90_RAMP, HALF_CELL, HALF_CELL),  // SS90R
+    turn_shape(90, SS90_RADIUS, SS90_RAMP, HALF_CELL, HALF_CELL),  // SS90L
+    turn_shape(180, u_turn_radius(SS180_RAMP), SS180_RAMP, 0, 0),  // SS180R
+    turn_shape(180, u_turn_radius(SS180_RAMP), SS180_RAMP, 0, 0),  // SS180L
+    turn_shape(45, 90, 30, 0, 0),                                  // SD45R
+    turn_shape(45, 90, 30, 0, 0),                                  // SD45L
+    turn_shape(135, 45, 20, FULL_CELL, HALF_DIAGONAL),             // SD135R
+    turn_shape(135, 45, 20, FULL_CELL, HALF_DIAGONAL),             // SD135L
+    turn_shape(45, 90, 30, 0, 0),                                  // DS45R
+    turn_shape(45, 90, 30, 0, 0),                                  // DS45L
+    turn_shape(135, 45, 20, HALF_DIAGONAL, FULL_CELL),             // DS135R
+    turn_shape(135, 45, 20, HALF_DIAGONAL, FULL_CELL),             // DS135L
+    turn_shape(90, 45, 20, 0, 0),                                  // DD90R
+    turn_shape(90, 45, 20, 0, 0),                                  // DD90L
+};
+
+// the rotation must reach full speed before it has turned through the angle
+constexpr bool shapes_fit(int i) {
+  return i >= MOVE_TYPES || ((turn_shapes[i].angle == 0 || turn_shapes[i].ramp / turn_shapes[i].radius * (180 / PI) <= turn_shapes[i].angle) && shapes_fit(i + 1));
+}
+
+static_assert(shapes_fit(0), "a turn ramp is too long for its angle");
+
+void get_turn_shape(move_t turn, TurnShape &shape) {
+  if (turn >= MOVE_TYPES) {
+    turn = MOVE_STOP;
+  }
+  memcpy_P(&shape, &turn_shapes[turn], sizeof(TurnShape));
+}
+
+// in deg/s so that the arc has the right radius
+float turn_omega(const TurnShape &shape, float speed) {
+  return speed / shape.radius * (180 / PI);
+}
+
+// in deg/s/s so that omega is reached after the ramp distance
+float turn_alpha(const TurnShape &shape, float speed) {
+  return turn_omega(shape, speed) * speed / shape.ramp;
+}
+
+/***
+ * The time, in seconds, from the reference point at the start of the turn
+ * to the one at the end at a steady speed. A negative run in or run out
+ * takes time off the straights instead.
+ */
+float turn_time(move_t turn, float speed) {
+  TurnShape shape;
+  get_turn_shape(turn, shape);
+  if (shape.angle == 0) {
+    return 0;
+  }
+  float omega = turn_omega(shape, speed);
+  float alpha = turn_alpha(shape, speed);
+  return (shape.run_in + shape.run_out) / speed + profile_time(shape.angle, 0, omega, 0, alpha);
+}
+
+/***
+ * Queue only the rotation of the turn. A played back ramp takes a whole
+ * number of ticks so it is a fraction of a tick out at most speeds. That
+ * moves the path by less than a tick of travel.
+ */
+void queue_turn_rotation(move_t turn, const TurnShape &shape, float speed) {
+  float angle = -45 * turn_angle(turn);
+#if TURN_PLAYBACK
+  uint16_t ramp_ticks = (uint16_t)(shape.ramp / (speed * LOOP_INTERVAL) + 0.5f);
+  queue_playback(angle, turn_omega(shape, speed), ramp_ticks);
+#else
+  queue_rotation(angle, turn_omega(shape, speed), 0, turn_alpha(shape, speed));
+#endif
+}
+
+/***
+ * Queue the whole turn at a steady speed. The robot should already be
+ * going at that speed. Any negative run in or run out is left to the
+ * caller to take off the straights.
+ */
+void queue_turn(move_t turn, float speed) {
+  TurnShape shape;
+  get_turn_shape(turn, shape);
+  if (shape.angle == 0) {
+    return;
+  }
+  if (shape.run_in > 0) {
+    queue_forward(shape.run_in, speed, speed, SEARCH_ACCELERATION);
+  }
+  queue_turn_rotation(turn, shape, speed);
+  if (shape.run_out > 0) {
+    queue_forward(shape.run_out, speed, speed, SEARCH_ACCELERATION);
+  }
+}
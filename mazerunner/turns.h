@@ -0,0 +1,74 @@
+/*
+ * File: turns.h
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+
+
+#ifndef TURNS_H
+#define TURNS_H
+
+#include "diagonal.h"
+#include "mouse.h"
+#include <stdint.h>
+
+/***
+ * Every smooth turn is described by its shape rather than by speeds:
+ *
+ *   angle   - the change of heading in degrees. The direction comes from
+ *             turn_angle() in diagonal.cpp.
+ *   radius  - the radius of the arc in the middle of the turn, in mm.
+ *   ramp    - the distance travelled while the rotation builds up to full
+ *             speed, and again while it dies away.
+ *   run_in  - the straight from the reference point at the start of the
+ *             turn to where the rotation begins.
+ *   run_out - the straight from where the rotation ends to the reference
+ *             point at the end of the turn.
+ *
+ * The omega and alpha for a given forward speed are worked out when the
+ * turn is made. Omega goes up with the speed and alpha with its square so
+ * the robot follows the same path at any speed.
+ *
+ * The reference points are where the moves in the move lists join. A
+ * negative run in or run out means the rotation starts before the
+ * reference point or ends after it. That much must come off the straight
+ * on that side.
+ */
+struct TurnShape {
+  float angle;
+  float radius;
+  float ramp;
+  float run_in;
+  float run_out;
+};
+
+void get_turn_shape(move_t turn, TurnShape &shape);
+float turn_omega(const TurnShape &shape, float speed);
+float turn_alpha(const TurnShape &shape, float speed);
+float turn_time(move_t turn, float speed);
+void queue_turn_rotation(move_t turn, const TurnShape &shape, float speed);
+void queue_turn(move_t turn, float speed);
+
+#endif // TURNS_H
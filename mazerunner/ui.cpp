@@ -33,6 +33,9 @@
 #include "ui.h"
 #include "digitalWriteFast.h"
 #include "maze.h"
+#include "maze_check.h"
+#include "maze_store.h"
+#include "maze_text.h"
 #include "reports.h"
 #include "sensors.h"
 #include "settings.h"
@@ -280,11 +283,107 @@ void cli_prompt() {
   Serial.print(' ');
 }
 
+/***
+ * Manage the copy of the maze held in EEPROM.
+ *   M    - report whether there is a valid stored maze
+ *   M !  - store the current maze, writing only the bytes that changed
+ *   M @  - replace the current maze with the stored copy
+ */
+void cli_maze_store_command(const Args &args) {
+  if (args.argc == 1) {
+    Serial.print(F("Stored maze: "));
+    Serial.println(stored_maze_is_valid() ? F("valid") : F("none"));
+    return;
+  }
+  char c = args.argv[1][0];
+  if (c == '!') {
+    int count = save_maze_to_eeprom();
+    Serial.print(F("Maze stored: "));
+    Serial.print(count);
+    Serial.println(F(" bytes changed"));
+  } else if (c == '@') {
+    if (load_maze_from_eeprom()) {
+      Serial.println(F("Maze restored"));
+    } else {
+      Serial.println(F("No valid stored maze"));
+    }
+  }
+}
+
+/***
+ * Check the whole maze map for walls that cannot be right. Walls set from
+ * only one side and missing outside walls are repaired as they are found.
+ */
+void cli_check_maze() {
+  uint8_t problems = maze_check_all();
+  if (problems == 0) {
+    Serial.println(F("Maze map OK"));
+    return;
+  }
+  if (problems & MAP_ONE_SIDED) {
+    Serial.println(F("Walls set from one side only (repaired)"));
+  }
+  if (problems & MAP_NO_BOUNDARY) {
+    Serial.println(F("Outside walls missing (repaired)"));
+  }
+  if (problems & MAP_ISOLATED) {
+    Serial.println(F("Cells with four walls"));
+  }
+  if (problems & MAP_GOAL_CLOSED) {
+    Serial.println(F("No way into the goal"));
+  }
+  if (problems & MAP_NO_ROUTE) {
+    Serial.println(F("No route from start to goal"));
+  }
+}
+
+/***
+ * Read a maze drawing pasted into the terminal. The characters go
+ * straight to the maze reader rather than through the input line so
+ * there is no limit on the line length. Reading stops at the bottom
+ * line of the maze or after two seconds with no input.
+ *
+ * The reader clears the map before it starts, so text that stops short
+ * would leave a map with half its walls missing. Instead, the stored maze
+ * is restored or, if there is none, the empty maze. The map in RAM is not
+ * kept while reading because there is no room for a second copy.
+ */
+void cli_read_maze_text() {
+  Serial.println(F("Paste the maze text"));
+  maze_text_begin();
+  uint32_t last_input = millis();
+  while (!maze_text_complete() && millis() - last_input < 2000) {
+    if (Serial.available()) {
+      maze_text_add(Serial.read());
+      last_input = millis();
+    }
+  }
+  maze_text_add('\n');
+  if (maze_text_complete()) {
+    Serial.println(F("Maze loaded"));
+    return;
+  }
+  Serial.print(F("Incomplete maze text - "));
+  if (load_maze_from_eeprom()) {
+    Serial.println(F("stored maze restored"));
+  } else {
+    initialise_maze(emptyMaze);
+    Serial.println(F("no stored maze, maze reset"));
+  }
+}
+
 void cli_help() {
   Serial.println(F("$   : settings"));
   Serial.println(F("W   : display maze walls"));
   Serial.println(F("X   : reset maze"));
   Serial.println(F("R   : display maze with directions"));
+  Serial.println(F("Q   : flood queue high-water mark"));
+  Serial.println(F("L   : load maze from pasted text"));
+  Serial.println(F("P   : show cells pruned from the search"));
+  Serial.println(F("C   : check the maze map"));
+  Serial.println(F("M   : stored maze status"));
+  Serial.println(F("M ! : store maze to EEPROM"));
+  Serial.println(F("M @ : restore maze from EEPROM"));
   Serial.println(F("S   : show sensor readings"));
   Serial.println(F("T n : Run Test n"));
   Serial.println(F("       0 = ---"));
@@ -305,6 +404,16 @@ void cli_help() {
   Serial.println(F("      15 = ---"));
   Serial.println(F("      20 = test edge detection"));
   Serial.println(F("      21 = sensor spin calibration"));
+  Serial.println(F("      22 = incremental flood check"));
+  Serial.println(F("      23 = queue vs bitboard flood"));
+  Serial.println(F("      24 = maze function timing"));
+  Serial.println(F("      25 = D* Lite vs flood planning (DSTAR_PLANNER only)"));
+  Serial.println(F("      26 = diagonal path compiler check"));
+  Serial.println(F("      27 = maze map checker"));
+  Serial.println(F("      28 = S-curve profile check"));
+  Serial.println(F("      29 = systick ISR time"));
+  Serial.println(F("      30 = queued smooth turn"));
+  Serial.println(F("      31 = explore from the goal area"));
   Serial.println(F("U n : Run user function n"));
   Serial.println(F("       0 = ---"));
   Serial.println(F("       1 = log front sensor "));
@@ -345,6 +454,33 @@ void cli_interpret(const Args &args) {
       case 'R':
         print_maze_with_directions();
         break;
+      case 'Q':
+        Serial.print(F("Flood queue high water: "));
+        Serial.print(flood_queue_high_water());
+        Serial.print('/');
+        Serial.print(flood_queue_capacity());
+        Serial.print(F(" overflows: "));
+        Serial.println(flood_queue_overflows());
+        Serial.print(F("Stack headroom: "));
+        Serial.println(stack_headroom());
+        break;
+      case 'L':
+        cli_read_maze_text();
+        break;
+      case 'P':
+        prune_maze(maze_goal(), START);
+        flood_maze(maze_goal());
+        print_maze_with_costs();
+        Serial.print(F("Pruned cells: "));
+        Serial.println(pruned_cell_count());
+        clear_pruned_cells();
+        break;
+      case 'M':
+        cli_maze_store_command(args);
+        break;
+      case 'C':
+        cli_check_maze();
+        break;
       case 'S':
         enable_sensors();
         delay(10);
@@ -0,0 +1,159 @@
+/*
+ * File: bench.cpp
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "Arduino.h"
+#include "host_maze.h"
+#include "maze.h"
+#include "mouse.h"
+#include <algorithm>
+#include <time.h>
+
+/***
+ * Host benchmark for the maze functions that run while the mouse is
+ * moving. It times the same things as test 24 does on the robot:
+ *
+ *   flood  - flood_maze() to the goal, including the downhill table when
+ *            DOWNHILL_TABLE is set. The operations are cells queued, so
+ *            they are zero when BITBOARD_FLOOD is set.
+ *   path   - make_path() from the start. The operations are moves in the list.
+ *   dir    - direction_to_smallest() for every cell. The operations are calls.
+ *
+ * The built in mazes are always measured. Maze text files named on the
+ * command line are measured as well.
+ *
+ * The times are host times in microseconds, so only their ratios mean
+ * much. The host cannot count AVR cycles. Instead, every time is scaled
+ * by the same factor, chosen so that a cell queued by the queue flood of
+ * the empty maze costs AVR_CYCLES_PER_FLOOD_CELL. That gives an estimate
+ * of the AVR time for everything else, whatever flood engine is built.
+ * The operation counts do not depend on the host at all, so any change
+ * in them is a real change.
+ */
+
+const int RUNS = 1000;
+
+/***
+ * The full flood was measured at 5.3ms on the robot with no interrupts.
+ * That is 84800 cycles at 16MHz for the 256 cells of a 16x16 maze. Use
+ * the cycles column of test 24 from your own robot if you have it.
+ */
+const double AVR_CYCLES_PER_FLOOD_CELL = 331.0;
+
+static double s_cycles_per_ns = 0;
+
+static double now_ns() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/***
+ * Sort the run times and print the mean, 99th percentile and worst case,
+ * the operations in each run and the estimated AVR cycles and time.
+ */
+static void report_timing(const char *name, double *times, uint32_t operations) {
+  std::sort(times, times + RUNS);
+  double total = 0;
+  for (int i = 0; i < RUNS; i++) {
+    total += times[i];
+  }
+  double mean = total / RUNS;
+  double cycles = mean * s_cycles_per_ns;
+  printf("%s %8.2f %8.2f %8.2f %6u %10.0f %8.0f\n", name, mean / 1000, times[(RUNS * 99) / 100 - 1] / 1000,
+         times[RUNS - 1] / 1000, operations / RUNS, cycles, cycles / (F_CPU / 1000000L));
+}
+
+static void time_maze(const char *name) {
+  static double times[RUNS];
+  printf("maze %s\n", name);
+  printf("            mean      p99      max    ops avr cycles   avr us\n");
+  uint32_t pushes = flood_queue_pushes();
+  for (int i = 0; i < RUNS; i++) {
+    double start = now_ns();
+    flood_maze(maze_goal());
+    times[i] = now_ns() - start;
+  }
+  pushes = flood_queue_pushes() - pushes;
+  report_timing("flood ", times, pushes);
+
+  uint32_t steps = 0;
+  for (int i = 0; i < RUNS; i++) {
+    double start = now_ns();
+    dorothy.make_path(START);
+    times[i] = now_ns() - start;
+    for (int k = 0; moves[k] != MOVE_STOP; k++) {
+      steps++;
+    }
+  }
+  report_timing("path  ", times, steps);
+
+  volatile uint8_t direction = NORTH;
+  for (int i = 0; i < RUNS; i++) {
+    double start = now_ns();
+    for (int cell = 0; cell < MAZE_CELLS; cell++) {
+      direction = direction_to_smallest(cell, direction);
+    }
+    times[i] = now_ns() - start;
+  }
+  report_timing("dir   ", times, (uint32_t)MAZE_CELLS * RUNS);
+  printf("\n");
+}
+
+static void set_scale() {
+  initialise_maze(emptyMaze);
+  for (int i = 0; i < RUNS; i++) {
+    flood_maze_queue(maze_goal());  // warm up before timing
+  }
+  uint32_t pushes = flood_queue_pushes();
+  double total = 0;
+  for (int i = 0; i < RUNS; i++) {
+    double start = now_ns();
+    flood_maze_queue(maze_goal());
+    total += now_ns() - start;
+  }
+  pushes = flood_queue_pushes() - pushes;
+  s_cycles_per_ns = AVR_CYCLES_PER_FLOOD_CELL * pushes / total;
+}
+
+int main(int argc, char **argv) {
+  printf("%dx%d maze, %d runs, times in host microseconds\n\n", MAZE_WIDTH, MAZE_WIDTH, RUNS);
+  set_scale();
+  initialise_maze(emptyMaze);
+  time_maze("empty");
+#if MAZE_WIDTH == 16
+  initialise_maze(japan2007);
+  time_maze("japan2007");
+#endif
+  for (int i = 1; i < argc; i++) {
+    if (!load_maze_text(argv[i])) {
+      printf("%s is not a %dx%d maze\n", argv[i], MAZE_WIDTH, MAZE_WIDTH);
+      return 1;
+    }
+    time_maze(argv[i]);
+  }
+  return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * File: dstar_check.cpp
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "Arduino.h"
+#include "dstar.h"
+#include "host_maze.h"
+#include "maze.h"
+
+#if !DSTAR_PLANNER
+#error "dstar_check needs DSTAR_PLANNER set to 1"
+#endif
+
+/***
+ * Check the D* Lite planner against the flood. Each maze is searched
+ * to the goal and back with the planner, as in test 25. The route and
+ * the cost the planner gave each cell on it are kept. The same route is
+ * then followed again with the incremental flood. At every step the
+ * planner's cost must match the flood and the next cell must be one
+ * cell nearer the target, so the planner only ever takes shortest
+ * routes. The number of cells each one worked on is totalled.
+ */
+
+const int GENERATED_MAZES = 200;
+const int LOOPS[] = {0, MAZE_CELLS / 8, MAZE_CELLS / 2};
+const int MAX_STEPS = 4 * MAZE_CELLS;
+
+static uint8_t s_maze[MAZE_CELLS];
+static cell_t s_route[2][MAX_STEPS];
+static uint16_t s_cost[2][MAX_STEPS];
+static int s_steps[2];
+static int s_mazes = 0;
+static int s_failures = 0;
+static uint32_t s_route_cells = 0;
+static uint32_t s_expanded = 0;
+static uint32_t s_flooded = 0;
+
+static bool plan_leg(int leg, cell_t &location, uint8_t &heading, cell_t target) {
+  s_steps[leg] = 0;
+  dstar_begin(target, location);
+  while (!is_target(location, target)) {
+    reveal_maze_cell(s_maze, location);
+    dstar_move_to(location);
+    heading = dstar_direction(heading);
+    if (s_steps[leg] == MAX_STEPS || cost[location] == MAX_COST) {
+      dstar_end();
+      return false;
+    }
+    s_route[leg][s_steps[leg]] = location;
+    s_cost[leg][s_steps[leg]] = cost[location];
+    s_steps[leg]++;
+    location = neighbour(location, heading);
+  }
+  dstar_end();
+  return true;
+}
+
+static bool flood_leg(int leg, cell_t target) {
+  flood_maze(target);
+  for (int i = 0; i < s_steps[leg]; i++) {
+    cell_t location = s_route[leg][i];
+    cell_t next = (i + 1 < s_steps[leg]) ? s_route[leg][i + 1] : target;
+    reveal_maze_cell(s_maze, location);
+    update_flood(target);
+    if (cost[location] != s_cost[leg][i]) {
+      return false;
+    }
+    if (!is_target(next, target) && cost[next] != cost[location] - 1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void check_maze(const char *name) {
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    s_maze[i] = walls[i];
+  }
+  s_mazes++;
+  cell_t targets[] = {maze_goal(), START};
+  cell_t location = START;
+  uint8_t heading = NORTH;
+  bool ok = true;
+  initialise_maze(emptyMaze);
+  uint32_t expansions = dstar_expansions();
+  for (int leg = 0; leg < 2 && ok; leg++) {
+    ok = plan_leg(leg, location, heading, targets[leg]);
+  }
+  expansions = dstar_expansions() - expansions;
+  initialise_maze(emptyMaze);
+  uint32_t pushes = flood_queue_pushes();
+  for (int leg = 0; leg < 2 && ok; leg++) {
+    ok = flood_leg(leg, targets[leg]);
+  }
+  pushes = flood_queue_pushes() - pushes;
+  if (!ok) {
+    printf("%s: the planner does not match the flood\n", name);
+    s_failures++;
+    return;
+  }
+  if (s_mazes == 1) {
+    printf("%s: route %d cells, planner %u cells, flood %u cells\n", name, s_steps[0] + s_steps[1],
+           (unsigned)expansions, (unsigned)pushes);
+  }
+  s_route_cells += s_steps[0] + s_steps[1];
+  s_expanded += expansions;
+  s_flooded += pushes;
+}
+
+int main(int argc, char **argv) {
+  char name[32];
+#if MAZE_WIDTH == 16
+  initialise_maze(japan2007);
+  check_maze("japan2007");
+#endif
+  for (int i = 1; i < argc; i++) {
+    if (!load_maze_text(argv[i])) {
+      printf("%s is not a %dx%d maze\n", argv[i], MAZE_WIDTH, MAZE_WIDTH);
+      return 1;
+    }
+    check_maze(argv[i]);
+  }
+  for (int loops : LOOPS) {
+    for (int seed = 1; seed <= GENERATED_MAZES; seed++) {
+      generate_maze(seed, loops);
+      snprintf(name, sizeof(name), "maze %d loops %d", seed, loops);
+      check_maze(name);
+    }
+  }
+  printf("D* Lite mazes searched: %d  failed: %d\n", s_mazes, s_failures);
+  printf("route cells: %u  planner cells: %u  flood cells: %u\n", (unsigned)s_route_cells, (unsigned)s_expanded,
+         (unsigned)s_flooded);
+  return s_failures == 0 ? 0 : 1;
+}
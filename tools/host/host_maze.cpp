@@ -0,0 +1,167 @@
+/*
+ * File: host_maze.cpp
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "host_maze.h"
+#include "Arduino.h"
+#include "maze_text.h"
+
+bool load_maze_text(const char *filename) {
+  FILE *file = fopen(filename, "r");
+  if (!file) {
+    return false;
+  }
+  maze_text_begin();
+  int c;
+  while ((c = fgetc(file)) != EOF && !maze_text_add(c)) {
+  }
+  fclose(file);
+  maze_text_add('\n');
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    walls[i] |= VISITED;
+  }
+  return maze_text_complete();
+}
+
+// a small generator so that the mazes do not depend on the C library
+static uint32_t s_random;
+
+static uint32_t next_random(uint32_t range) {
+  s_random ^= s_random << 13;
+  s_random ^= s_random >> 17;
+  s_random ^= s_random << 5;
+  return s_random % range;
+}
+
+static bool on_edge(cell_t cell, uint8_t direction) {
+  uint8_t x = cell / MAZE_WIDTH;
+  uint8_t y = cell % MAZE_WIDTH;
+  return (direction == NORTH && y == MAZE_WIDTH - 1) || (direction == EAST && x == MAZE_WIDTH - 1) ||
+         (direction == SOUTH && y == 0) || (direction == WEST && x == 0);
+}
+
+static void open_wall(cell_t cell, uint8_t direction) {
+  walls[cell] &= ~(1 << direction);
+  walls[neighbour(cell, direction)] &= ~(1 << ((direction + 2) & 0x03));
+}
+
+void generate_maze(uint32_t seed, int loops) {
+  static cell_t stack[MAZE_CELLS];
+  static bool carved[MAZE_CELLS];
+  s_random = seed * 2654435761u + 1;
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    walls[i] = VISITED | 0x0F;
+    carved[i] = false;
+  }
+  int depth = 0;
+  stack[depth++] = START;
+  carved[START] = true;
+  while (depth > 0) {
+    cell_t cell = stack[depth - 1];
+    uint8_t choices[4];
+    uint8_t count = 0;
+    for (uint8_t d = 0; d < 4; d++) {
+      // the start cell is always closed to the east
+      if (!on_edge(cell, d) && !carved[neighbour(cell, d)] && !(cell == START && d == EAST)) {
+        choices[count++] = d;
+      }
+    }
+    if (count == 0) {
+      depth--;
+      continue;
+    }
+    uint8_t direction = choices[next_random(count)];
+    cell_t next = neighbour(cell, direction);
+    open_wall(cell, direction);
+    carved[next] = true;
+    stack[depth++] = next;
+  }
+  for (int i = 0; i < loops; i++) {
+    cell_t cell = next_random(MAZE_CELLS);
+    uint8_t direction = next_random(4);
+    if (!on_edge(cell, direction) && !(cell == START && direction == EAST)) {
+      open_wall(cell, direction);
+    }
+  }
+  for (uint8_t i = 0; i < maze_goal_count(); i++) {
+    for (uint8_t j = 0; j < maze_goal_count(); j++) {
+      for (uint8_t d = 0; d < 4; d++) {
+        if (!on_edge(maze_goal_cell(i), d) && neighbour(maze_goal_cell(i), d) == maze_goal_cell(j)) {
+          open_wall(maze_goal_cell(i), d);
+        }
+      }
+    }
+  }
+}
+
+void reveal_maze_cell(const uint8_t *maze, cell_t cell) {
+  for (uint8_t d = 0; d < 4; d++) {
+    if (maze[cell] & (1 << d)) {
+      set_wall_present(cell, d);
+    }
+  }
+  mark_cell_visited(cell);
+}
+
+static bool search_leg(const uint8_t *maze, cell_t &location, uint8_t &heading, cell_t target) {
+  uint8_t plan[8];
+  flood_maze(target);
+  for (int steps = 0; steps < 4 * MAZE_CELLS; steps++) {
+    reveal_maze_cell(maze, location);
+    if (is_target(location, target)) {
+      clear_pruned_cells();
+      return true;
+    }
+    prune_maze(target, location);
+    update_flood(target);
+    if (cost[location] == MAX_COST) {
+      return false;
+    }
+    heading = direction_to_smallest(location, heading);
+    location = neighbour(location, heading);
+    if (!is_target(location, target)) {
+      plan_decisions(target, location, heading, plan);
+    }
+  }
+  return false;
+}
+
+bool simulate_search(const uint8_t *maze) {
+  initialise_maze(emptyMaze);
+  cell_t location = START;
+  uint8_t heading = NORTH;
+  bool ok = search_leg(maze, location, heading, maze_goal());
+  set_exact_target(true);
+  cell_t target;
+  for (int legs = 0; ok && legs < MAZE_CELLS && !maze_is_solved() && nearest_frontier_cell(location, &target); legs++) {
+    ok = search_leg(maze, location, heading, target);
+  }
+  set_exact_target(false);
+  ok = ok && search_leg(maze, location, heading, START);
+  flood_maze_weighted(maze_goal());
+  flood_maze_closed(maze_goal());
+  return ok;
+}
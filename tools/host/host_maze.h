@@ -0,0 +1,66 @@
+/*
+ * File: host_maze.h
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#ifndef HOST_MAZE_H
+#define HOST_MAZE_H
+
+#include "maze.h"
+
+/***
+ * Maze sources for the host programs. Both leave the maze in walls[]
+ * with every cell visited, as if it had been fully searched.
+ */
+
+/***
+ * Read a maze text file. Returns false if the file cannot be read or
+ * does not hold a whole maze.
+ */
+bool load_maze_text(const char *filename);
+
+/***
+ * Make a random maze by carving a spanning tree from the start cell and
+ * then knocking out extra walls to make loops. The start cell always has
+ * a wall to the east and the goal area is always open inside. The same seed always gives the same maze on any host.
+ */
+void generate_maze(uint32_t seed, int loops);
+
+/***
+ * Add the walls of a cell in the given copy of a maze to the map, just
+ * as the mouse finds them, and mark the cell visited.
+ */
+void reveal_maze_cell(const uint8_t *maze, cell_t cell);
+
+/***
+ * Search the current map the way the mouse does, with the walls of the
+ * maze in the given copy revealed a cell at a time. The mouse goes to
+ * the goal, explores until the maze is solved and comes back to the
+ * start. Every cell prunes, updates the flood and plans the next cell
+ * ahead. Returns false if the mouse ever finds itself with no route.
+ */
+bool simulate_search(const uint8_t *maze);
+
+#endif // HOST_MAZE_H
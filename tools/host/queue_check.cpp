@@ -0,0 +1,115 @@
+/*
+ * File: queue_check.cpp
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "Arduino.h"
+#include "host_maze.h"
+#include "maze.h"
+
+/***
+ * The flood queues hold FLOOD_QUEUE_LENGTH cells. A queue that fills
+ * still gives the right costs but the flood has to go back for the cells
+ * that did not fit, which is slow. This check simulates whole searches,
+ * just as the mouse does them, and fails if any flood queue ever fills.
+ * After each search, the queue flood and the bitboard flood must give
+ * the same costs on the map the mouse made and on the whole maze.
+ *
+ * The mazes are the built in mazes, any maze text files named on the
+ * command line and a set of generated mazes. The generated mazes are
+ * the same on every host, so the result is always the same.
+ */
+
+const int GENERATED_MAZES = (MAZE_WIDTH == 16) ? 200 : 20;
+const int LOOPS[] = {0, MAZE_CELLS / 8, MAZE_CELLS / 2};
+
+static uint8_t s_maze[MAZE_CELLS];
+static int s_searches = 0;
+static int s_failures = 0;
+
+static bool floods_agree() {
+  static uint16_t saved[MAZE_CELLS];
+  cell_t targets[] = {maze_goal(), START};
+  for (cell_t target : targets) {
+    flood_maze_queue(target);
+    for (int i = 0; i < MAZE_CELLS; i++) {
+      saved[i] = cost[i];
+    }
+    flood_maze_bitboard(target);
+    for (int i = 0; i < MAZE_CELLS; i++) {
+      if (cost[i] != saved[i]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static void check_maze(const char *name) {
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    s_maze[i] = walls[i];
+  }
+  s_searches++;
+  if (!simulate_search(s_maze)) {
+    printf("%s: the search failed\n", name);
+    s_failures++;
+    return;
+  }
+  bool agree = floods_agree();
+  for (int i = 0; i < MAZE_CELLS; i++) {
+    walls[i] = s_maze[i];
+  }
+  invalidate_flood();
+  if (!agree || !floods_agree()) {
+    printf("%s: the floods do not agree\n", name);
+    s_failures++;
+  }
+}
+
+int main(int argc, char **argv) {
+  char name[32];
+#if MAZE_WIDTH == 16
+  initialise_maze(japan2007);
+  check_maze("japan2007");
+#endif
+  for (int i = 1; i < argc; i++) {
+    if (!load_maze_text(argv[i])) {
+      printf("%s is not a %dx%d maze\n", argv[i], MAZE_WIDTH, MAZE_WIDTH);
+      return 1;
+    }
+    check_maze(argv[i]);
+  }
+  for (int loops : LOOPS) {
+    for (int seed = 1; seed <= GENERATED_MAZES; seed++) {
+      generate_maze(seed, loops);
+      snprintf(name, sizeof(name), "maze %d loops %d", seed, loops);
+      check_maze(name);
+    }
+  }
+  printf("%dx%d mazes searched: %d  failed: %d\n", MAZE_WIDTH, MAZE_WIDTH, s_searches, s_failures);
+  printf("flood queue high water: %d of %d  overflows: %d\n", flood_queue_high_water(), flood_queue_capacity(),
+         flood_queue_overflows());
+  return (s_failures == 0 && flood_queue_overflows() == 0) ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+/*
+ * File: Arduino.h
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+/***
+ * Just enough of the Arduino core for the mazerunner sources to build and
+ * run on a desktop computer. Serial output goes to stdout and the pins and
+ * registers are plain variables that do nothing. Only the maze code is
+ * meant to run here. Anything that waits on the hardware will not work.
+ */
+
+#include "avr/pgmspace.h"
+#include <ctype.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define F_CPU 16000000UL
+
+// the last EEPROM address. Set it on the command line for a bigger processor.
+#ifndef E2END
+#define E2END 0x3FF
+#endif
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define DEFAULT 1
+#define LED_BUILTIN 13
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+template <class A, class B>
+inline auto min(A a, B b) -> decltype(a + b) { return a < b ? a : b; }
+template <class A, class B>
+inline auto max(A a, B b) -> decltype(a + b) { return a > b ? a : b; }
+template <class T, class L, class H>
+inline auto constrain(T x, L low, H high) -> decltype(x + low + high) { return x < low ? low : (x > high ? high : x); }
+
+#define bit(b) (1UL << (b))
+#define bitSet(v, b) ((v) |= (1UL << (b)))
+#define bitClear(v, b) ((v) &= ~(1UL << (b)))
+#define bitRead(v, b) (((v) >> (b)) & 1)
+#define sbi(r, b) ((r) |= (1 << (b)))
+#define cbi(r, b) ((r) &= ~(1 << (b)))
+
+inline bool isPrintable(int c) { return isprint(c); }
+
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+unsigned long millis();
+unsigned long micros();
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+void interrupts();
+void noInterrupts();
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(PSTR(s)))
+
+struct HardwareSerial {
+  void begin(long) {}
+  int available() { return 0; }
+  int read() { return -1; }
+  void flush() { fflush(stdout); }
+  size_t write(uint8_t c) { return putchar(c) != EOF; }
+  size_t write(const char *s) { return printf("%s", s); }
+  size_t print(const __FlashStringHelper *s) { return printf("%s", (const char *)s); }
+  size_t print(const char *s) { return printf("%s", s); }
+  size_t print(char c) { return printf("%c", c); }
+  size_t print(unsigned char v, int base = DEC) { return print((unsigned)v, base); }
+  size_t print(int v, int base = DEC) { return printf(base == HEX ? "%X" : "%d", v); }
+  size_t print(unsigned v, int base = DEC) { return printf(base == HEX ? "%X" : "%u", v); }
+  size_t print(long v, int base = DEC) { return printf(base == HEX ? "%lX" : "%ld", v); }
+  size_t print(unsigned long v, int base = DEC) { return printf(base == HEX ? "%lX" : "%lu", v); }
+  size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+  template <class T>
+  size_t println(T v) { return print(v) + println(); }
+  template <class T>
+  size_t println(T v, int format) { return print(v, format) + println(); }
+  size_t println() { return printf("\n"); }
+};
+extern HardwareSerial Serial;
+
+// the registers used by the robot code
+extern volatile uint8_t PORTB, PORTC, PORTD, PINB, PINC, PIND, DDRB, DDRC, DDRD;
+extern volatile uint8_t ADCSRA, ADMUX, ADCL, ADCH, TCCR1B, TCCR2A, TCCR2B, TIMSK2, TCNT2, OCR2A;
+extern volatile uint8_t EIMSK, EICRA, SREG;
+extern volatile uint16_t ADC;
+enum { ADPS0, ADPS1, ADPS2, ADIE, ADIF, ADATE, ADSC, ADEN };
+enum { CS10, CS11, CS12 };
+enum { CS20, CS21, CS22 };
+enum { WGM20, WGM21, WGM22 = 3 };
+enum { TOIE2, OCIE2A, OCIE2B };
+enum { INT0, INT1 };
+enum { ISC00, ISC01, ISC10, ISC11 };
+
+#define ISR_NOBLOCK
+#define ISR(vector, ...) extern "C" void vector(void); void vector(void)
+
+#endif // ARDUINO_H
@@ -0,0 +1,60 @@
+/*
+ * File: EEPROM.h
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#include "Arduino.h"
+#include <stdint.h>
+#include <string.h>
+
+/***
+ * The EEPROM, held in RAM. It is the size of the ATmega328 EEPROM unless
+ * E2END says otherwise. It starts erased and is lost when the program
+ * ends.
+ */
+struct EEPROMClass {
+  EEPROMClass() { memset(data, 0xFF, sizeof(data)); }
+  uint8_t read(int address) { return data[address]; }
+  void write(int address, uint8_t value) { data[address] = value; }
+  void update(int address, uint8_t value) { data[address] = value; }
+  template <class T>
+  T &get(int address, T &t) {
+    memcpy(&t, data + address, sizeof(T));
+    return t;
+  }
+  template <class T>
+  const T &put(int address, const T &t) {
+    memcpy(data + address, &t, sizeof(T));
+    return t;
+  }
+  uint16_t length() { return sizeof(data); }
+  uint8_t data[E2END + 1];
+};
+extern EEPROMClass EEPROM;
+
+#endif // EEPROM_H
@@ -0,0 +1,58 @@
+/*
+ * File: arduino.cpp
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "Arduino.h"
+#include "EEPROM.h"
+#include <time.h>
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+
+volatile uint8_t PORTB, PORTC, PORTD, PINB, PINC, PIND, DDRB, DDRC, DDRD;
+volatile uint8_t ADCSRA, ADMUX, ADCL, ADCH, TCCR1B, TCCR2A, TCCR2B, TIMSK2, TCNT2, OCR2A;
+volatile uint8_t EIMSK, EICRA, SREG;
+volatile uint16_t ADC;
+
+unsigned long micros() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000UL + now.tv_nsec / 1000;
+}
+
+unsigned long millis() {
+  return micros() / 1000;
+}
+
+void delay(unsigned long) {}
+void delayMicroseconds(unsigned int) {}
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+int digitalRead(uint8_t) { return 0; }
+int analogRead(uint8_t) { return 0; }
+void analogWrite(uint8_t, int) {}
+void interrupts() {}
+void noInterrupts() {}
@@ -0,0 +1,64 @@
+/*
+ * File: pgmspace.h
+ * Project: mazerunner
+ *
+ *  MIT License
+ *
+ *  Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#ifndef PGMSPACE_H
+#define PGMSPACE_H
+
+/***
+ * There is only one address space on the host so flash data is just
+ * ordinary constant data.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_byte_near(p) pgm_read_byte(p)
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_word_near(p) pgm_read_word(p)
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define pgm_read_float(p) (*(const float *)(p))
+
+#define memcpy_P memcpy
+#define sprintf_P sprintf
+#define strcasecmp_P strcasecmp
+#define strcat_P strcat
+#define strcmp_P strcmp
+#define strcpy_P strcpy
+#define strlen_P strlen
+#define strncasecmp_P strncasecmp
+#define strncmp_P strncmp
+#define strncpy_P strncpy
+#define strstr_P strstr
+
+#endif // PGMSPACE_H
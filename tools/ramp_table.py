@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+#
+# File: ramp_table.py
+# Project: mazerunner
+#
+# MIT License
+#
+# Copyright (c) 2019-2021 UK Micromouse and Robotics Society
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+"""
+Writes the rotation ramp table used when TURN_PLAYBACK is set in config.h.
+
+The table holds the rotation speed, as a fraction of the full speed, while
+it builds up at the start of a smooth turn. The robot plays it forwards to
+start the turn and backwards to end it, stretched to however many ticks the
+ramp takes at the turn speed.
+
+Every shape here has f(u) + f(1 - u) = 1 so the ramp always turns through
+half the angle that the full speed would. That keeps the sums in the
+firmware the same whatever the shape.
+
+The shape also decides where the turn has to start. The terms for the
+shift and set back of the arc are worked out here and written into the
+header for turns.cpp.
+
+    python3 tools/ramp_table.py --shape sine --bits 6
+
+run from the project folder writes mazerunner/ramp_table.h and
+mazerunner/ramp_table.cpp.
+"""
+
+import argparse
+import math
+import os
+
+SHAPES = {
+    # straight line. The path is a clothoid, just like the trapezoid
+    'linear': lambda u: u,
+    # half a cosine wave. No step in the angular acceleration at either end
+    'sine': lambda u: 0.5 * (1 - math.cos(math.pi * u)),
+    # the cubic smoothstep. Much the same as the sine
+    'cubic': lambda u: u * u * (3 - 2 * u),
+}
+
+STEPS = 20000
+
+
+def integrals(f):
+    """
+    With u the fraction of the ramp, F is the integral of f and G the
+    integral of F. Returns G(1) and the integrals of F^2 and F^3 over the
+    ramp. Plain trapezium rule. The shapes are smooth so that is plenty.
+    """
+    h = 1.0 / STEPS
+    F = 0.0
+    G = 0.0
+    F2 = 0.0
+    F3 = 0.0
+    last_f = f(0.0)
+    last_F = 0.0
+    for i in range(1, STEPS + 1):
+        fi = f(i * h)
+        Fi = F + 0.5 * (last_f + fi) * h
+        G += 0.5 * (last_F + Fi) * h
+        F2 += 0.5 * (last_F ** 2 + Fi ** 2) * h
+        F3 += 0.5 * (last_F ** 3 + Fi ** 3) * h
+        F = Fi
+        last_f = fi
+        last_F = Fi
+    return G, F2, F3
+
+
+def geometry(f):
+    """
+    For a ramp of length L into an arc of radius R, the small angle series
+    give
+        shift    = SHIFT_2 * L^2 / R - SHIFT_4 * L^4 / R^3
+        set back = L / 2 - SET_BACK_3 * L^3 / R^2
+    For the linear ramp these come out as 1/24, 1/2688 and 1/240.
+    """
+    G, F2, F3 = integrals(f)
+    return G - 1.0 / 8, F3 / 6 - 1.0 / 384, F2 / 2 - 1.0 / 48
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--shape', choices=sorted(SHAPES), default='sine')
+    parser.add_argument('--bits', type=int, default=6, help='the table has 2^bits steps')
+    parser.add_argument('--out', default=os.path.join(os.path.dirname(__file__), '..', 'mazerunner'))
+    args = parser.parse_args()
+    if not 2 <= args.bits <= 8:
+        parser.error('bits must be from 2 to 8')
+
+    f = SHAPES[args.shape]
+    steps = 1 << args.bits
+    table = [min(65535, int(round(65535 * f(i / steps)))) for i in range(steps + 1)]
+    shift_2, shift_4, set_back_3 = geometry(f)
+
+    with open(os.path.join(args.out, 'ramp_table.h'), 'w') as h:
+        h.write('// Written by tools/ramp_table.py --shape {} --bits {}. Do not edit.\n'.format(args.shape, args.bits))
+        h.write('#ifndef RAMP_TABLE_H\n#define RAMP_TABLE_H\n\n')
+        h.write('#include <Arduino.h>\n\n')
+        h.write('#define RAMP_TABLE_BITS {}\n\n'.format(args.bits))
+        h.write('// the rotation speed as a fraction of 65535 at each step of the ramp\n')
+        h.write('extern const uint16_t ramp_table[{}] PROGMEM;\n\n'.format(steps + 1))
+        h.write('// the shift and set back of an arc entered along this ramp. See turns.cpp\n')
+        h.write('constexpr float RAMP_SHIFT_2 = {:.8f};\n'.format(shift_2))
+        h.write('constexpr float RAMP_SHIFT_4 = {:.8f};\n'.format(shift_4))
+        h.write('constexpr float RAMP_SET_BACK_3 = {:.8f};\n\n'.format(set_back_3))
+        h.write('#endif\n')
+
+    with open(os.path.join(args.out, 'ramp_table.cpp'), 'w') as c:
+        c.write('// Written by tools/ramp_table.py --shape {} --bits {}. Do not edit.\n'.format(args.shape, args.bits))
+        c.write('#include "ramp_table.h"\n\n')
+        c.write('const uint16_t ramp_table[{}] PROGMEM = {{\n'.format(steps + 1))
+        for i in range(0, steps + 1, 8):
+            c.write('    ' + ' '.join('{:5d},'.format(v) for v in table[i:i + 8]) + '\n')
+        c.write('};\n')
+
+
+if __name__ == '__main__':
+    main()